@@ -0,0 +1,34 @@
+// Header del ordenamiento por lotes: muchos archivos de enteros de 64 bits ordenados a la vez en un mismo proceso,
+// repartiendo un presupuesto de memoria y el ancho de banda del dispositivo entre los trabajos activos
+#ifndef BATCH_SORT_HPP
+#define BATCH_SORT_HPP
+
+#include <string>
+#include <vector>
+#include "memory_governor.hpp"
+
+struct BatchSortOptions {
+    long long memory_budget = 0;       // bytes de memoria compartidos por todos los trabajos activos
+    long B_SIZE = 0;                   // tamaño del bloque en bytes (0 = el del perfil del dispositivo)
+    int a = 16;                        // aridad de la mezcla
+    int max_jobs = 0;                  // trabajos simultáneos (0 = hilos del hardware)
+    int io_slots = 0;                  // mezclas simultáneas (0 = profundidad de cola del perfil, 1 sin perfil)
+    std::string temp_directory = ".";  // directorio de los temporales (y del perfil del dispositivo)
+};
+
+// Resultado de un trabajo (mergesort de input en output)
+struct BatchJobResult {
+    std::string input;
+    std::string output;
+    long M_SIZE;              // memoria asignada al trabajo
+    long long disk_access;
+    long long start_ms;       // desde el inicio del lote
+    long long io_wait_ms;     // espera por un turno de mezcla
+    long long end_ms;
+    std::vector<MemoryGovernor::PhaseStats> phases;  // fases del trabajo (máximo de su parte de la arena y tiempo)
+};
+
+// Ordena cada archivo de files en archivo + ".sorted" con un mergesort por trabajo; retorna los resultados en el orden de files
+std::vector<BatchJobResult> run_batch_sort(const std::vector<std::string>& files, const BatchSortOptions& options);
+
+#endif
@@ -0,0 +1,2054 @@
+// Motor genérico de ordenamiento externo (solo header), parametrizado por tipo de registro, extractor de llave y comparador.
+// run_mergesort y run_radixsort son instancias de ExternalSorter<int64_t>; run_quicksort es el motor afinado para llaves puras
+// al que ExternalSorter<int64_t>::quicksort delega en tiempo de compilación.
+//
+// Los registros son de tamaño fijo y se leen y escriben como bytes (deben ser trivialmente copiables), por ejemplo
+// TimestampRecord<56>: llave de 64 bits (timestamp) + 56 bytes de payload.
+#ifndef EXTERNAL_SORTER_HPP
+#define EXTERNAL_SORTER_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <queue>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "fence_index.hpp"
+#include "memory_governor.hpp"
+#include "sort_manifest.hpp"
+#include "quicksort.hpp"
+#include "sort_context.hpp"
+
+// --------------------------------- Registros y llaves ---------------------------------
+
+// La llave es el registro completo (archivos de enteros como los que escribe generate_sequence)
+template <typename Record>
+struct IdentityKey {
+    const Record& operator()(const Record& record) const { return record; }
+};
+
+// Registro de log: timestamp de 64 bits como llave + payload de PayloadBytes bytes
+template <std::size_t PayloadBytes>
+struct TimestampRecord {
+    static_assert(PayloadBytes >= 8 && PayloadBytes <= 120, "el payload debe tener entre 8 y 120 bytes");
+    std::int64_t timestamp;
+    unsigned char payload[PayloadBytes];
+};
+
+struct TimestampKey {
+    template <typename Record>
+    std::int64_t operator()(const Record& record) const { return record.timestamp; }
+};
+
+// Par (llave, id de registro) del modo llave/puntero: se ordenan los pares y el payload se mueve una sola vez al final
+template <typename Key>
+struct KeyPointer {
+    Key key;
+    std::uint64_t id;
+};
+
+// Orden de los pares: por llave según Compare y, si empatan, por id (los registros con igual llave conservan su orden)
+template <typename Compare>
+struct KeyPointerLess {
+    Compare comp;
+    template <typename Key>
+    bool operator()(const KeyPointer<Key>& x, const KeyPointer<Key>& y) const {
+        if (comp(x.key, y.key)) return true;
+        if (comp(y.key, x.key)) return false;
+        return x.id < y.id;
+    }
+};
+
+// Operador que se aplica al mezclar: los registros con llave igual se colapsan al formar los tramos y en cada mezcla
+// DISTINCT: se conserva el primer registro de cada llave; COUNT: la salida son pares KeyCount (llave, número de apariciones)
+enum class MergeOperator { NONE, DISTINCT, COUNT };
+
+template <typename Key>
+struct KeyCount {
+    Key key;
+    std::uint64_t count;
+};
+
+struct KeyCountKey {
+    template <typename Key>
+    const Key& operator()(const KeyCount<Key>& record) const { return record.key; }
+};
+
+template <typename Record>
+struct is_key_count : std::false_type {};
+template <typename Key>
+struct is_key_count<KeyCount<Key>> : std::true_type {};
+
+// --------------------------------- Motor genérico ---------------------------------
+
+template <typename Record, typename KeyFn = IdentityKey<Record>, typename Compare = std::less<>>
+class ExternalSorter {
+    static_assert(std::is_trivially_copyable_v<Record>, "los registros se leen y escriben como bytes, deben ser trivialmente copiables");
+
+public:
+    using Key = std::decay_t<std::invoke_result_t<KeyFn, const Record&>>;
+
+    // Orden ascendente natural sobre la llave (requisito del camino radix)
+    static constexpr bool ascending_order = std::is_same_v<Compare, std::less<>> || std::is_same_v<Compare, std::less<Key>>;
+    // Registros que son solo una llave entera de 64 bits: se usan los caminos afinados (buckets de igualdad por conteo, motor de quicksort)
+    static constexpr bool pure_key = std::is_integral_v<Record> && sizeof(Record) == sizeof(std::int64_t) && std::is_signed_v<Record>
+                                     && std::is_same_v<KeyFn, IdentityKey<Record>> && ascending_order;
+    // Llaves enteras en orden ascendente: se puede distribuir por bits de la llave sin comparaciones
+    static constexpr bool radix_capable = std::is_integral_v<Key> && sizeof(Key) <= sizeof(std::uint64_t) && ascending_order;
+
+    ExternalSorter(long B_SIZE, long M_SIZE, int a, KeyFn key = KeyFn(), Compare comp = Compare())
+        : B_SIZE(B_SIZE), M_SIZE(M_SIZE), a(a), key(key), comp(comp),
+          recordsPerBlock(std::max(1L, B_SIZE / (long)sizeof(Record))),
+          recordsInMemory(std::max(1L, M_SIZE / (long)sizeof(Record))), context(B_SIZE, M_SIZE, a) {}
+    // Con un contexto propio (directorio de temporales, opciones del quicksort): toma de él B, M y a
+    explicit ExternalSorter(const SortContext& context, KeyFn key = KeyFn(), Compare comp = Compare())
+        : ExternalSorter(context.B_SIZE, context.M_SIZE, context.a, key, comp) { this->context = context; runPrefix = context.tempName("run_"); }
+
+    long long mergesort(const std::string& inputFile, const std::string& outputFile);
+    // Mezcla de archivos ya ordenados, sin formar tramos (valida el orden mientras lee)
+    long long mergeSorted(const std::vector<std::string>& inputFiles, const std::string& outputFile);
+    void setMergeOperator(MergeOperator op) { mergeOperator = op; }
+    // Con checkpoints el mergesort lleva un manifiesto (salida + ".manifest") y sus tramos se llaman salida + ".run_<i>.bin";
+    // si al empezar encuentra un manifiesto de la misma entrada y parámetros, retoma desde el último trabajo completo
+    void setCheckpoint(bool enabled) { checkpoint = enabled; }
+    // Con S > 1 el mergesort escribe la salida en S shards por rango de llave (salida + ".shard<i>") de tamaños parejos, según
+    // separadores muestreados al formar los tramos, y un índice con los límites de cada shard (salida + ".shards")
+    void setShards(int num_shards) { numShards = std::max(1, num_shards); }
+    // Índice de S shards sobre un archivo ya ordenado (por ejemplo la salida en el lugar del quicksort): rangos de registros de
+    // tamaño parejo que no parten llaves repetidas, con O(S log N) lecturas de bloque y sin reescribir el archivo
+    long long shardSortedFile(const std::string& sortedFile, int num_shards);
+    // Con k > 0 el mergesort, el quicksort y el radix sort escriben junto a la salida un índice disperso (salida + ".fence",
+    // un ".fence" por shard) con la primera llave de cada k-ésimo bloque, armado con las escrituras de la salida final;
+    // las consultas por rango sobre ese índice se hacen con FenceLookup (fence_index.hpp)
+    void setFenceIndex(long blocks_per_fence) { fenceBlocks = std::max(0L, blocks_per_fence); }
+    long long quicksort(const std::string& inputFile, long N_SIZE);
+    long long radixsort(const std::string& inputFile, const std::string& outputFile, long N_SIZE);
+    long long keyPointerSort(const std::string& inputFile, const std::string& outputFile);
+    long long topK(const std::string& inputFile, const std::string& outputFile, long K);
+
+private:
+    long B_SIZE;               // tamaño del bloque en bytes
+    long M_SIZE;               // tamaño de la memoria principal en bytes
+    int a;                     // aridad del mergesort / particiones del quicksort / buckets del radix
+    KeyFn key;
+    Compare comp;
+    long recordsPerBlock;      // registros que caben en un bloque B
+    long recordsInMemory;      // registros que caben en M
+    long long countIO = 0;     // contador de operaciones de E/S (una por bloque leído o escrito)
+    SortContext context;       // temporales y generador aleatorio propios: varios sorters pueden correr a la vez
+    MergeOperator mergeOperator = MergeOperator::NONE;
+    bool checkpoint = false;
+    std::string runPrefix = context.tempName("run_");  // prefijo de los archivos de los tramos
+    SortManifest* manifest = nullptr;      // manifiesto del mergesort en curso (solo con checkpoints)
+
+    // El sorter de pares (llave, conteo) del modo COUNT mezcla los tramos que escribe este; el de streaming usa sus funciones de archivo
+    template <typename, typename, typename> friend class ExternalSorter;
+    template <typename, typename, typename> friend class StreamingSorter;
+
+    bool less(const Record& x, const Record& y) const { return comp(key(x), key(y)); }
+    bool sameKey(const Record& x, const Record& y) const { return !comp(key(x), key(y)) && !comp(key(y), key(x)); }
+    // Junta en into un registro con la misma llave (solo los conteos se suman; en DISTINCT se conserva into)
+    void combine(Record& into, const Record& from) const {
+        if constexpr (is_key_count<Record>::value) {
+            if (mergeOperator == MergeOperator::COUNT) into.count += from.count;
+        }
+    }
+    // El modo COUNT sobre registros que no son pares (llave, conteo) cambia el tipo de los tramos
+    bool countsKeys() const { return mergeOperator == MergeOperator::COUNT && !is_key_count<Record>::value; }
+    void sortRecords(ArenaVector<Record>& records) const {
+        std::sort(records.begin(), records.end(), [this](const Record& x, const Record& y) { return less(x, y); });
+    }
+    // Deja ordenados solo los primeros limit registros (los limit menores)
+    void sortRecords(ArenaVector<Record>& records, long limit) const {
+        if (limit >= (long)records.size()) return sortRecords(records);
+        std::partial_sort(records.begin(), records.begin() + limit, records.end(), [this](const Record& x, const Record& y) { return less(x, y); });
+    }
+
+    static FILE* openFile(const char* fileName, const char* mode);
+    static long countRecords(const std::string& fileName);
+    void readRecords(const std::string& fileName, ArenaVector<Record>& buffer, long numRecords);
+    void writeRecords(FILE* output, long recordOffset, const Record* data, long numRecords);
+    void copyRecords(const std::string& fileName, FILE* output, long recordOffset, long numRecords);
+
+    // Mergesort
+    std::string runFileName(int i) const { return runPrefix + std::to_string(i) + ".bin"; }
+    int createInitialRuns(const char* input_file, long long first_record, int num_runs, int extendable_from);
+    void mergeFiles(const char* output_file_name, int first_run, int num_runs, int output_run);
+    void mergeRuns(const std::string& outputFile, int num_runs);
+    template <typename Out>
+    void writeRun(const char* file_name, const Out* data, long num_records, bool append, std::uint64_t& checksum);
+    // Checkpoints: verifica un tramo contra su entrada del manifiesto (lo recorta si quedó más largo) y retoma la fase de tramos
+    bool verifyRun(const std::string& fileName, long record_size, const SortManifest::RunEntry& entry);
+    int resumeInitialRuns(long long& first_record, int& extendable_from);
+    void removeRuns(int first_run, int num_runs);
+    void concatenateRuns(const std::string& outputFile, const std::vector<int>& order);
+    bool mergeSortedPass(const std::vector<std::string>& inputs, const std::string& outputFile, bool final_output, bool validate);
+    std::vector<std::pair<Record, Record>> runBounds;  // primer y último registro de cada tramo inicial
+
+    // Shards de la salida
+    static constexpr long SHARD_OVERSAMPLING = 256;  // muestras por shard para elegir los separadores
+    int numShards = 1;
+    long long sampleStride = 0;       // se muestrea una llave cada sampleStride registros de cada tramo ordenado
+    std::vector<Key> shardSamples;
+    std::vector<Key> shardSplitters;  // S - 1 separadores: el shard i tiene las llaves en [separador i - 1, separador i)
+    struct ShardEntry {
+        std::string file;
+        long long first_record;       // primer registro del shard dentro de file
+        long long records;
+        Key first, last;              // primera y última llave (sin sentido si records = 0)
+    };
+    class ShardWriter;
+    void chooseSplitters(const std::string& inputFile);
+    static void writeShardIndex(const std::string& indexFile, const std::vector<ShardEntry>& shards);
+    static std::string keyText(const Key& k);
+
+    // Índice disperso de la salida
+    long fenceBlocks = 0;  // k: bloques entre llaves del índice (0 = sin índice)
+    FenceIndexBuilder<Key> fenceBuilder;
+    template <typename SortFn>
+    void withFenceIndex(const std::string& sortedFile, SortFn sort);
+
+    // Entradas ya ordenadas: 1 = ascendente, -1 = descendente, 0 = ninguna (se detiene en la primera inversión)
+    int presortedDirection(const std::string& inputFile, long N_SIZE);
+    void reverseInPlace(FILE* file, long N_SIZE);
+
+    // Quicksort genérico (registros con payload); limit = registros iniciales de la partición que se necesitan
+    // (N_SIZE en un ordenamiento completo, menos en el quickselect de topK)
+    struct QuicksortTask { long id; long N_SIZE; long outputOffset; long limit; };
+    void quicksortLevel(const std::string& inputFile, const QuicksortTask& task, FILE* output,
+                        std::vector<QuicksortTask>& tasks, long& nextTaskId);
+
+    // Radix
+    std::uint64_t radixKey(const Record& record) const;
+    void radixLevel(const std::string& inputFile, const std::string& fileName, bool isInput, long N_SIZE,
+                    std::uint64_t minKey, std::uint64_t maxKey, int bits, FILE* output, long outputOffset, long& nextBucketId);
+};
+
+// --------------------------------- Funciones de I/O por bloque ---------------------------------
+
+template <typename Record, typename KeyFn, typename Compare>
+FILE* ExternalSorter<Record, KeyFn, Compare>::openFile(const char* fileName, const char* mode) {
+    /* Abre un archivo y termina el programa si no se puede
+    args:
+        fileName: nombre del archivo
+        mode: modo de fopen
+    returns:
+        puntero al archivo abierto
+    */
+
+    FILE* fp = fopen(fileName, mode);
+    if (fp == NULL) {
+        perror("Error while opening the file");
+        exit(EXIT_FAILURE);
+    }
+    return fp;
+}
+
+
+template <typename Record, typename KeyFn, typename Compare>
+long ExternalSorter<Record, KeyFn, Compare>::countRecords(const std::string& fileName) {
+    /* Número de registros completos que contiene un archivo
+    args:
+        fileName: nombre del archivo
+    returns:
+        número de registros
+    */
+
+    return std::filesystem::file_size(fileName) / sizeof(Record);
+}
+
+
+template <typename Record, typename KeyFn, typename Compare>
+void ExternalSorter<Record, KeyFn, Compare>::readRecords(const std::string& fileName, ArenaVector<Record>& buffer, long numRecords) {
+    /* Lee numRecords registros de un archivo y los agrega al final del buffer, por bloques de tamaño B
+    args:
+        fileName: nombre del archivo a leer
+        buffer: vector donde se agregan los registros
+        numRecords: número de registros a leer
+    returns:
+        void
+    */
+
+    size_t offset = buffer.size();
+    buffer.resize(offset + numRecords);
+    FILE* file = openFile(fileName.c_str(), "rb");
+    for (long read = 0; read < numRecords; read += recordsPerBlock) {
+        size_t _ = fread(buffer.data() + offset + read, sizeof(Record), std::min(recordsPerBlock, numRecords - read), file);
+        countIO++;
+    }
+    fclose(file);
+}
+
+
+template <typename Record, typename KeyFn, typename Compare>
+void ExternalSorter<Record, KeyFn, Compare>::writeRecords(FILE* output, long recordOffset, const Record* data, long numRecords) {
+    /* Escribe los registros en el archivo de salida a partir de la posición dada, por bloques de tamaño B
+    args:
+        output: puntero al archivo de salida
+        recordOffset: posición (en registros) donde empieza la escritura
+        data: puntero a los registros a escribir
+        numRecords: número de registros
+    returns:
+        void
+    */
+
+    fseek(output, recordOffset * (long)sizeof(Record), SEEK_SET);
+    for (long written = 0; written < numRecords; written += recordsPerBlock) {
+        long count = std::min(recordsPerBlock, numRecords - written);
+        fwrite(data + written, sizeof(Record), count, output);
+        countIO++;
+        context.outputWritten(recordOffset + written, data + written, count);
+    }
+}
+
+
+template <typename Record, typename KeyFn, typename Compare>
+void ExternalSorter<Record, KeyFn, Compare>::copyRecords(const std::string& fileName, FILE* output, long recordOffset, long numRecords) {
+    /* Copia los primeros numRecords registros de un archivo a la salida a partir de la posición dada, de a un bloque B
+    (para datos que ya están en orden y pueden no caber en M)
+    args:
+        fileName: nombre del archivo a copiar
+        output: puntero al archivo de salida
+        recordOffset: posición (en registros) donde empieza la escritura
+        numRecords: número de registros a copiar
+    returns:
+        void
+    */
+
+    FILE* file = openFile(fileName.c_str(), "rb");
+    ArenaVector<Record> block(std::min(recordsPerBlock, std::max(1L, numRecords)));
+    for (long copied = 0; copied < numRecords; ) {
+        size_t numRead = fread(block.data(), sizeof(Record), std::min((long)block.size(), numRecords - copied), file);
+        if (numRead == 0) break;
+        countIO++;
+        writeRecords(output, recordOffset + copied, block.data(), numRead);
+        copied += numRead;
+    }
+    fclose(file);
+}
+
+// --------------------------------- Mergesort externo ---------------------------------
+
+// Escribe un tramo en su archivo temporal (o lo agrega al final, si continúa un tramo natural), por bloques B.
+// Con checkpoints continúa el checksum del tramo y deja el archivo en disco antes de que se anote en el manifiesto
+template <typename Record, typename KeyFn, typename Compare>
+template <typename Out>
+void ExternalSorter<Record, KeyFn, Compare>::writeRun(const char* file_name, const Out* data, long num_records, bool append,
+                                                      std::uint64_t& checksum) {
+    long out_per_block = std::max(1L, B_SIZE / (long)sizeof(Out));
+    FILE* current_out_file = openFile(file_name, append ? "ab" : "wb");
+    for (long written = 0; written < num_records; written += out_per_block) {
+        fwrite(data + written, sizeof(Out), std::min(out_per_block, num_records - written), current_out_file);
+        countIO++; // Contar escritura
+    }
+    if (manifest) {
+        checksum = SortManifest::checksum(checksum, data, num_records * sizeof(Out));
+        fflush(current_out_file);
+        fsync(fileno(current_out_file));
+    }
+    fclose(current_out_file);
+}
+
+
+// Verifica que el tramo fileName tenga los registros y el checksum anotados en el manifiesto; si el archivo quedó más largo
+// (el proceso murió después de escribir y antes de anotar) se recorta a lo anotado
+template <typename Record, typename KeyFn, typename Compare>
+bool ExternalSorter<Record, KeyFn, Compare>::verifyRun(const std::string& fileName, long record_size, const SortManifest::RunEntry& entry) {
+    std::error_code error;
+    long long bytes = entry.records * record_size;
+    long long size = std::filesystem::file_size(fileName, error);
+    if (error || size < bytes) return false;
+    if (size > bytes) std::filesystem::resize_file(fileName, bytes, error);
+    if (error) return false;
+
+    FILE* in = openFile(fileName.c_str(), "rb");
+    std::vector<char> block(std::max<long>(B_SIZE, record_size));
+    std::uint64_t checksum = SortManifest::CHECKSUM_SEED;
+    size_t read_count;
+    while ((read_count = fread(block.data(), 1, block.size(), in)) > 0) {
+        countIO++;
+        checksum = SortManifest::checksum(checksum, block.data(), read_count);
+    }
+    fclose(in);
+    return checksum == entry.checksum;
+}
+
+
+// Retoma la fase de tramos desde el manifiesto: conserva los tramos que se verifican en orden (el primero que falla y los
+// siguientes se rehacen) y reconstruye sus registros extremos. Retorna el número de tramos conservados; first_record es
+// la posición de la entrada donde sigue la fase y extendable_from el primer tramo que se puede extender
+template <typename Record, typename KeyFn, typename Compare>
+int ExternalSorter<Record, KeyFn, Compare>::resumeInitialRuns(long long& first_record, int& extendable_from) {
+    long record_size = countsKeys() ? sizeof(KeyCount<Key>) : sizeof(Record);
+    int num_runs = 0;
+    first_record = 0;
+    runBounds.clear();
+    while (manifest->runs.count(num_runs) && verifyRun(runFileName(num_runs), record_size, manifest->runs[num_runs])) {
+        first_record = manifest->runs[num_runs].input_end;
+        num_runs++;
+    }
+
+    // En COUNT los tramos son pares (llave, conteo) y no se pueden recuperar los registros extremos: no se extienden, y
+    // runBounds queda sin ellos (con menos extremos que tramos, mergeRuns no intenta concatenarlos)
+    extendable_from = countsKeys() ? num_runs : 0;
+    if (!countsKeys()) {
+        runBounds.resize(num_runs);
+        for (int i = 0; i < num_runs; i++) {
+            FILE* in = openFile(runFileName(i).c_str(), "rb");
+            size_t _ = fread(&runBounds[i].first, sizeof(Record), 1, in);
+            fseek(in, -(long)sizeof(Record), SEEK_END);
+            _ = fread(&runBounds[i].second, sizeof(Record), 1, in);
+            countIO += 2;
+            fclose(in);
+        }
+    }
+    return num_runs;
+}
+
+
+// Borra los tramos first_run, ..., first_run + num_runs - 1
+template <typename Record, typename KeyFn, typename Compare>
+void ExternalSorter<Record, KeyFn, Compare>::removeRuns(int first_run, int num_runs) {
+    for (int i = 0; i < num_runs; i++) {
+        remove(runFileName(first_run + i).c_str());
+    }
+}
+
+
+// input_file: nombre del archivo de entrada
+// first_record, num_runs: posición de la entrada y tramos ya escritos desde donde se sigue (0 y 0 salvo al retomar un checkpoint)
+// extendable_from: los tramos anteriores a este no se extienden (al retomar en COUNT no se conocen sus registros extremos)
+// Cada tramo de M se lee por bloques B directo al buffer del tramo, se ordena en memoria y se escribe por bloques
+// en su propio archivo temporal (runFileName(i): prefijo temporal del contexto + "run_<i>.bin", o salida + ".run_<i>.bin"
+// con checkpoints); retorna el número de tramos creados.
+// Con un operador de mezcla los duplicados del tramo se colapsan antes de escribirlo (en COUNT se escriben pares KeyCount).
+// Tramos naturales: un tramo que ya viene ascendente no se ordena y uno descendente solo se invierte; si además empieza
+// donde terminó el anterior, se agrega a su archivo (con la entrada ya ordenada queda un único tramo)
+template <typename Record, typename KeyFn, typename Compare>
+int ExternalSorter<Record, KeyFn, Compare>::createInitialRuns(const char* input_file, long long first_record, int num_runs, int extendable_from) {
+    FILE* in = openFile(input_file, "rb"); // Leer en modo binario
+    fseek(in, first_record * sizeof(Record), SEEK_SET);
+
+    long long total_records_in_file = countRecords(input_file);
+    long long total_records_processed = first_record;
+    // Registros por tramo: M, o con arena lo que quede libre de M descontando los buffers vivos (en COUNT, el buffer del tramo
+    // y el de sus pares, cada uno redondeado a ALIGNMENT como lo entrega la arena)
+    long run_records = recordsInMemory;
+    if (memory_governor.currentPolicy() != MemoryGovernor::UNLIMITED) {
+        size_t free_bytes = std::min<size_t>(M_SIZE, memory_governor.available());
+        auto run_bytes = [this](long records) {
+            size_t bytes = MemoryGovernor::roundUp(records * sizeof(Record));
+            if (countsKeys()) bytes += MemoryGovernor::roundUp(records * sizeof(KeyCount<Key>));
+            return bytes;
+        };
+        run_records = std::max(1L, (long)(free_bytes / (sizeof(Record) + (countsKeys() ? sizeof(KeyCount<Key>) : 0))));
+        while (run_records > 1 && run_bytes(run_records) > free_bytes) run_records--;
+    }
+    ArenaVector<Record> run_buffer(std::max(0LL, std::min((long long)run_records, total_records_in_file - first_record))); // Buffer para un tramo completo en memoria (M)
+    // Registros y checksum del último tramo (para anotarlo en el manifiesto cuando se extiende)
+    SortManifest::RunEntry last_run;
+    if (manifest && num_runs > 0) last_run = manifest->runs[num_runs - 1];
+    // Muestras para los separadores de los shards (solo desde el inicio: al retomar se muestrea el input en chooseSplitters)
+    sampleStride = numShards > 1 && first_record == 0 ? std::max(1LL, total_records_in_file / (numShards * SHARD_OVERSAMPLING)) : 0;
+
+    while (total_records_processed < total_records_in_file) {
+        // Leer un tramo completo, un bloque B a la vez
+        long records_in_current_run = 0;
+        while (records_in_current_run < run_records && total_records_processed < total_records_in_file) {
+            long records_to_read_this_block = std::min({recordsPerBlock, run_records - records_in_current_run,
+                                                        (long)(total_records_in_file - total_records_processed)});
+            size_t read_count = fread(run_buffer.data() + records_in_current_run, sizeof(Record), records_to_read_this_block, in);
+            countIO++; // Contar lectura
+
+            if (read_count == 0) {
+                if (ferror(in)) {
+                    perror("Error reading input file");
+                    exit(EXIT_FAILURE);
+                }
+                total_records_in_file = total_records_processed; // Fin de archivo
+                break;
+            }
+            records_in_current_run += read_count;
+            total_records_processed += read_count;
+        }
+
+        if (records_in_current_run > 0) {
+            auto run_begin = run_buffer.begin(), run_end = run_buffer.begin() + records_in_current_run;
+            auto run_less = [this](const Record& x, const Record& y) { return less(x, y); };
+            if (!std::is_sorted(run_begin, run_end, run_less)) {
+                if (std::is_sorted(run_begin, run_end, [this](const Record& x, const Record& y) { return less(y, x); })) {
+                    std::reverse(run_begin, run_end); // Tramo descendente
+                } else {
+                    std::sort(run_begin, run_end, run_less); // Ordenar el tramo en memoria
+                }
+            }
+            for (long i = 0; sampleStride > 0 && i < records_in_current_run; i += sampleStride) shardSamples.push_back(key(run_buffer[i]));
+
+            // El tramo continúa al anterior si no empieza antes de su último registro (con operador, estrictamente después,
+            // para que una llave no quede repetida dentro de un tramo)
+            bool extends_run = num_runs > extendable_from && (mergeOperator == MergeOperator::NONE ? !less(run_buffer[0], runBounds.back().second)
+                                                                                   : less(runBounds.back().second, run_buffer[0]));
+            if (extends_run) {
+                runBounds.back().second = run_buffer[records_in_current_run - 1];
+            } else {
+                runBounds.push_back({run_buffer[0], run_buffer[records_in_current_run - 1]});
+                num_runs++;
+            }
+
+            // Escribir el tramo ordenado en su archivo temporal, por bloques B
+            std::string run_name = runFileName(num_runs - 1);
+            if (!extends_run) last_run = SortManifest::RunEntry();
+            long written_records;
+            if (countsKeys()) {
+                ArenaVector<KeyCount<Key>> counts;
+                counts.reserve(records_in_current_run);
+                for (long i = 0; i < records_in_current_run; ++i) {
+                    if (i > 0 && sameKey(run_buffer[i - 1], run_buffer[i])) counts.back().count++;
+                    else counts.push_back({key(run_buffer[i]), 1});
+                }
+                writeRun(run_name.c_str(), counts.data(), counts.size(), extends_run, last_run.checksum);
+                written_records = counts.size();
+            } else {
+                if (mergeOperator != MergeOperator::NONE) {
+                    long unique_records = 0;
+                    for (long i = 0; i < records_in_current_run; ++i) {
+                        if (unique_records > 0 && sameKey(run_buffer[unique_records - 1], run_buffer[i])) combine(run_buffer[unique_records - 1], run_buffer[i]);
+                        else run_buffer[unique_records++] = run_buffer[i];
+                    }
+                    records_in_current_run = unique_records;
+                }
+                writeRun(run_name.c_str(), run_buffer.data(), records_in_current_run, extends_run, last_run.checksum);
+                written_records = records_in_current_run;
+            }
+            if (manifest) {
+                last_run.records += written_records;
+                last_run.input_end = total_records_processed;
+                manifest->recordRun(num_runs - 1, last_run);
+            }
+        }
+    }
+
+    fclose(in);
+    return num_runs;
+}
+
+
+// --------------------------------- Índice disperso de la salida ---------------------------------
+
+// Ejecuta sort armando el índice de sortedFile con lo que escribe en la salida final (context.on_output_write). Las llaves
+// de bloques que no se reescribieron (un único tramo que pasa a ser la salida, una entrada ya ordenada en el quicksort) se
+// leen del archivo al terminar, una lectura por llave
+template <typename Record, typename KeyFn, typename Compare>
+template <typename SortFn>
+void ExternalSorter<Record, KeyFn, Compare>::withFenceIndex(const std::string& sortedFile, SortFn sort) {
+    // Con shards cada shard lleva su índice (ShardWriter); en COUNT lo arma el sorter de pares
+    if (fenceBlocks <= 0 || numShards > 1 || countsKeys()) return sort();
+    fenceBuilder = FenceIndexBuilder<Key>(recordsPerBlock, fenceBlocks);
+    context.on_output_write = [this](long long offset, const void* data, long count) {
+        fenceBuilder.add(offset, static_cast<const Record*>(data), count, key);
+    };
+    sort();
+    context.on_output_write = nullptr;
+
+    long long records = countRecords(sortedFile);
+    std::vector<long long> missing = fenceBuilder.missing(records);
+    if (!missing.empty()) {
+        FILE* file = openFile(sortedFile.c_str(), "rb");
+        Record record;
+        for (long long position : missing) {
+            fseek(file, (long)position * (long)sizeof(Record), SEEK_SET);
+            if (fread(&record, sizeof(Record), 1, file) == 1) fenceBuilder.add(position, &record, 1, key);
+            countIO++;
+        }
+        fclose(file);
+    }
+    if (!fenceBuilder.save(sortedFile + ".fence", sizeof(Record), records)) {
+        std::cerr << "Error while writing the fence index " << sortedFile << ".fence" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    fenceBuilder = FenceIndexBuilder<Key>();
+}
+
+
+// --------------------------------- Shards de la salida ---------------------------------
+
+// Llave como texto para el índice de shards: números tal cual, otras llaves como sus bytes en hexadecimal
+template <typename Record, typename KeyFn, typename Compare>
+std::string ExternalSorter<Record, KeyFn, Compare>::keyText(const Key& k) {
+    if constexpr (std::is_arithmetic_v<Key>) {
+        return std::to_string(k);
+    } else {
+        static const char* digits = "0123456789abcdef";
+        const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&k);
+        std::string text;
+        for (size_t i = 0; i < sizeof(Key); ++i) {
+            text += digits[bytes[i] >> 4];
+            text += digits[bytes[i] & 15];
+        }
+        return text;
+    }
+}
+
+
+// Índice de shards (texto, una línea por shard):
+//   shards <S> records <registros>
+//   shard <i> <archivo> <primer registro> <registros> <primera llave> <última llave>   (llaves "-" si el shard está vacío)
+// Las llaves de un shard no se repiten en otro, así que un lector puede elegir sus shards solo con el índice
+template <typename Record, typename KeyFn, typename Compare>
+void ExternalSorter<Record, KeyFn, Compare>::writeShardIndex(const std::string& indexFile, const std::vector<ShardEntry>& shards) {
+    long long total = 0;
+    for (const ShardEntry& shard : shards) total += shard.records;
+    std::ofstream index(indexFile);
+    index << "shards " << shards.size() << " records " << total << "\n";
+    for (size_t i = 0; i < shards.size(); ++i) {
+        const ShardEntry& shard = shards[i];
+        index << "shard " << i << " " << shard.file << " " << shard.first_record << " " << shard.records << " "
+              << (shard.records > 0 ? keyText(shard.first) + " " + keyText(shard.last) : std::string("- -")) << "\n";
+    }
+    if (!index) {
+        std::cerr << "Error while writing the shard index " << indexFile << std::endl;
+        exit(EXIT_FAILURE);
+    }
+}
+
+
+// Separadores de los shards: cuantiles de las llaves muestreadas al formar los tramos. Si no hay muestras (al retomar con
+// los tramos ya hechos) se leen llaves del input en posiciones regulares, una lectura por muestra
+template <typename Record, typename KeyFn, typename Compare>
+void ExternalSorter<Record, KeyFn, Compare>::chooseSplitters(const std::string& inputFile) {
+    shardSplitters.clear();
+    if (numShards <= 1) return;
+    long long N = countRecords(inputFile);
+    if (shardSamples.empty() && N > 0) {
+        FILE* in = openFile(inputFile.c_str(), "rb");
+        long long samples = std::min<long long>(N, numShards * SHARD_OVERSAMPLING);
+        Record record;
+        for (long long i = 0; i < samples; ++i) {
+            fseek(in, (long)(i * N / samples) * (long)sizeof(Record), SEEK_SET);
+            if (fread(&record, sizeof(Record), 1, in) == 1) shardSamples.push_back(key(record));
+            countIO++;
+        }
+        fclose(in);
+    }
+    if (shardSamples.empty()) return;  // entrada vacía: todos los shards quedan vacíos
+    std::sort(shardSamples.begin(), shardSamples.end(), comp);
+    for (int i = 1; i < numShards; ++i) shardSplitters.push_back(shardSamples[(size_t)i * shardSamples.size() / numShards]);
+    shardSamples.clear();
+}
+
+
+// Escritor de la salida final en shards: recibe los registros en orden y los reparte según los separadores (un bloque que
+// cruza un separador se parte en dos escrituras); al cerrar crea los shards vacíos que falten y escribe el índice
+template <typename Record, typename KeyFn, typename Compare>
+class ExternalSorter<Record, KeyFn, Compare>::ShardWriter {
+public:
+    ShardWriter(ExternalSorter& sorter, const std::string& outputFile) : sorter(sorter), outputFile(outputFile) {
+        for (int i = 0; i < sorter.numShards; ++i) shards.push_back({outputFile + ".shard" + std::to_string(i), 0, 0, Key(), Key()});
+        if (sorter.fenceBlocks > 0) fence = FenceIndexBuilder<Key>(sorter.recordsPerBlock, sorter.fenceBlocks);
+    }
+
+    void write(const Record* data, long num_records) {
+        while (num_records > 0) {
+            // Registros del shard actual: los que quedan antes de su separador
+            long count = num_records;
+            if (current < (int)sorter.shardSplitters.size()) {
+                const Key& splitter = sorter.shardSplitters[current];
+                count = std::partition_point(data, data + num_records, [&](const Record& r) { return sorter.comp(sorter.key(r), splitter); }) - data;
+            }
+            if (count > 0) {
+                ShardEntry& shard = shards[current];
+                if (!file) file = openFile(shard.file.c_str(), "wb");
+                fwrite(data, sizeof(Record), count, file);
+                sorter.countIO++;
+                if (shard.records == 0) shard.first = sorter.key(data[0]);
+                shard.last = sorter.key(data[count - 1]);
+                if (fence.active()) fence.add(shard.records, data, count, sorter.key);
+                shard.records += count;
+                data += count;
+                num_records -= count;
+            }
+            if (num_records > 0) nextShard();
+        }
+    }
+
+    void close() {
+        while (current < (int)shards.size()) nextShard();
+        writeShardIndex(outputFile + ".shards", shards);
+    }
+
+private:
+    ExternalSorter& sorter;
+    std::string outputFile;
+    std::vector<ShardEntry> shards;
+    int current = 0;
+    FILE* file = nullptr;
+    FenceIndexBuilder<Key> fence;  // índice disperso del shard actual (con setFenceIndex)
+
+    void nextShard() {
+        // Cierra el shard actual (lo crea vacío si no recibió registros; con checkpoints lo deja en disco)
+        if (!file) file = openFile(shards[current].file.c_str(), "wb");
+        if (sorter.manifest) {
+            fflush(file);
+            fsync(fileno(file));
+        }
+        fclose(file);
+        file = nullptr;
+        if (fence.active()) {
+            const ShardEntry& shard = shards[current];
+            fence.missing(shard.records);
+            if (!fence.save(shard.file + ".fence", sizeof(Record), shard.records)) {
+                std::cerr << "Error while writing the fence index " << shard.file << ".fence" << std::endl;
+                exit(EXIT_FAILURE);
+            }
+            fence = FenceIndexBuilder<Key>(sorter.recordsPerBlock, sorter.fenceBlocks);
+        }
+        current++;
+    }
+};
+
+
+template <typename Record, typename KeyFn, typename Compare>
+long long ExternalSorter<Record, KeyFn, Compare>::shardSortedFile(const std::string& sortedFile, int num_shards) {
+    /* Escribe el índice de S shards (sortedFile + ".shards") de un archivo ya ordenado, como rangos de registros del mismo archivo.
+    Cada límite parte del registro N * i / S y retrocede al primero con su llave (o avanza tras el último, si retroceder
+    dejaría vacío el shard anterior), con búsquedas binarias de una lectura de bloque por paso
+    args:
+        sortedFile: archivo ordenado
+        num_shards: número de shards S
+    returns:
+        countIO: lecturas de bloque hechas
+    */
+
+    countIO = 0;
+    num_shards = std::max(1, num_shards);
+    long long N = countRecords(sortedFile);
+    FILE* file = openFile(sortedFile.c_str(), "rb");
+    auto keyAt = [&](long long position) {
+        Record record;
+        fseek(file, (long)position * (long)sizeof(Record), SEEK_SET);
+        size_t _ = fread(&record, sizeof(Record), 1, file);
+        countIO++;
+        return key(record);
+    };
+    // Primera posición en [lo, hi) cuya llave no cumple pred (pred es verdadero en un prefijo del rango)
+    auto partitionPoint = [&](long long lo, long long hi, auto pred) {
+        while (lo < hi) {
+            long long middle = lo + (hi - lo) / 2;
+            if (pred(keyAt(middle))) lo = middle + 1;
+            else hi = middle;
+        }
+        return lo;
+    };
+
+    std::vector<long long> bounds = {0};
+    for (int i = 1; i < num_shards; ++i) {
+        long long target = std::max(N * i / num_shards, bounds.back());
+        if (target >= N) {
+            bounds.push_back(N);
+            continue;
+        }
+        Key k = keyAt(target);
+        long long bound = partitionPoint(bounds.back(), target, [&](const Key& x) { return comp(x, k); });
+        if (bound == bounds.back() && bound < target) bound = partitionPoint(target, N, [&](const Key& x) { return !comp(k, x); });
+        bounds.push_back(bound);
+    }
+    bounds.push_back(N);
+
+    std::vector<ShardEntry> shards;
+    for (int i = 0; i < num_shards; ++i) {
+        ShardEntry shard = {sortedFile, bounds[i], bounds[i + 1] - bounds[i], Key(), Key()};
+        if (shard.records > 0) {
+            shard.first = keyAt(bounds[i]);
+            shard.last = keyAt(bounds[i + 1] - 1);
+        }
+        shards.push_back(shard);
+    }
+    fclose(file);
+    writeShardIndex(sortedFile + ".shards", shards);
+    return countIO;
+}
+
+
+// Mezcla archivos ordenados (los tramos first_run, ..., first_run + num_runs - 1) y los borra
+// output_file_name: nombre del archivo de salida
+// num_runs: numero de tramos a mezclar (a lo más a)
+// output_run: tramo que se escribe (se anota en el manifiesto con checkpoints), o -1 si es la salida final
+// El heap guarda solo el registro actual y el índice de su archivo; los buffers de lectura (un bloque B por archivo) quedan fuera
+// del heap para no copiarlos en cada push/pop.
+// Con un operador de mezcla, un registro con la misma llave que el último de la salida se junta con él; por eso el bloque
+// de salida se escribe recién cuando llega un registro con otra llave y ya no hay espacio
+template <typename Record, typename KeyFn, typename Compare>
+void ExternalSorter<Record, KeyFn, Compare>::mergeFiles(const char* output_file_name, int first_run, int num_runs, int output_run) {
+    // La salida final con shards va al escritor de shards; los tramos intermedios, a su archivo
+    std::unique_ptr<ShardWriter> shard_writer;
+    FILE* out = nullptr;
+    if (output_run < 0 && numShards > 1) shard_writer = std::make_unique<ShardWriter>(*this, output_file_name);
+    else out = openFile(output_file_name, "wb");
+    SortManifest::RunEntry written;  // registros y checksum de lo escrito (solo con checkpoints)
+    auto write_block = [&](const Record* data, long num_records) {
+        if (shard_writer) {
+            shard_writer->write(data, num_records);
+        } else {
+            fwrite(data, sizeof(Record), num_records, out);
+            countIO++;
+            if (output_run < 0) context.outputWritten(written.records, data, num_records);
+        }
+        if (manifest) written.checksum = SortManifest::checksum(written.checksum, data, num_records * sizeof(Record));
+        written.records += num_records;
+    };
+
+    struct RunReader {
+        FILE* file_ptr = nullptr;
+        ArenaVector<Record> buffer;
+        size_t buffer_pos = 0;
+        long long records_remaining_in_file = 0;
+    };
+    struct HeapNode {
+        Record record;
+        int i;
+    };
+    auto heap_greater = [this](const HeapNode& x, const HeapNode& y) { return less(y.record, x.record); };
+    std::priority_queue<HeapNode, std::vector<HeapNode>, decltype(heap_greater)> min_heap(heap_greater);
+
+    std::vector<RunReader> readers(num_runs);
+    ArenaVector<Record> output_buffer(recordsPerBlock);
+    long output_buffer_pos = 0;
+
+    // Lee el siguiente bloque del archivo i; retorna false si el archivo se terminó (y lo cierra)
+    auto refill = [&](int i) {
+        RunReader& reader = readers[i];
+        if (reader.records_remaining_in_file <= 0) {
+            if (reader.file_ptr) fclose(reader.file_ptr);
+            reader.file_ptr = nullptr;
+            return false;
+        }
+        reader.buffer.resize(std::min((long long)recordsPerBlock, reader.records_remaining_in_file));
+        size_t read_count = fread(reader.buffer.data(), sizeof(Record), reader.buffer.size(), reader.file_ptr);
+        countIO++;
+        reader.buffer.resize(read_count);
+        reader.buffer_pos = 0;
+        reader.records_remaining_in_file -= read_count;
+        if (read_count == 0) {
+            fclose(reader.file_ptr);
+            reader.file_ptr = nullptr;
+            return false;
+        }
+        return true;
+    };
+
+    for (int i = 0; i < num_runs; i++) {
+        std::string fileName = runFileName(first_run + i);
+        readers[i].file_ptr = fopen(fileName.c_str(), "rb");
+
+        if (readers[i].file_ptr == NULL) {
+            num_runs = i;
+            break;
+        }
+        readers[i].records_remaining_in_file = countRecords(fileName);
+        if (refill(i)) {
+            min_heap.push({readers[i].buffer[readers[i].buffer_pos++], i});
+        }
+    }
+
+    while (!min_heap.empty()) {
+        HeapNode root = min_heap.top();
+        min_heap.pop();
+
+        if (mergeOperator != MergeOperator::NONE && output_buffer_pos > 0 && sameKey(output_buffer[output_buffer_pos - 1], root.record)) {
+            combine(output_buffer[output_buffer_pos - 1], root.record);
+        } else {
+            if (output_buffer_pos == recordsPerBlock) {
+                write_block(output_buffer.data(), recordsPerBlock);
+                output_buffer_pos = 0;
+            }
+            output_buffer[output_buffer_pos++] = root.record;
+        }
+
+        RunReader& reader = readers[root.i];
+        if (reader.buffer_pos < reader.buffer.size() || refill(root.i)) {
+            min_heap.push({reader.buffer[reader.buffer_pos++], root.i});
+        }
+    }
+
+    // Escribir cualquier registro restante en el buffer de salida
+    if (output_buffer_pos > 0) write_block(output_buffer.data(), output_buffer_pos);
+
+    // Con checkpoints, el tramo mezclado queda en disco y anotado antes de borrar los que lo forman
+    if (shard_writer) {
+        shard_writer->close();
+    } else if (manifest) {
+        fflush(out);
+        fsync(fileno(out));
+    }
+    if (manifest) {
+        if (output_run >= 0) manifest->recordMerged(output_run, written);
+        else manifest->finish();
+    }
+    if (out) fclose(out);
+    removeRuns(first_run, num_runs);
+}
+
+
+// Copia los tramos en el orden dado a outputFile, por bloques B, y los borra (tramos con rangos de llaves disjuntos).
+// Con checkpoints los tramos se borran recién cuando la salida está completa
+template <typename Record, typename KeyFn, typename Compare>
+void ExternalSorter<Record, KeyFn, Compare>::concatenateRuns(const std::string& outputFile, const std::vector<int>& order) {
+    std::unique_ptr<ShardWriter> shard_writer;
+    FILE* out = nullptr;
+    if (numShards > 1) shard_writer = std::make_unique<ShardWriter>(*this, outputFile);
+    else out = openFile(outputFile.c_str(), "wb");
+    ArenaVector<Record> block(recordsPerBlock);
+    long long copied = 0;
+    for (int run : order) {
+        FILE* in = openFile(runFileName(run).c_str(), "rb");
+        size_t read_count;
+        while ((read_count = fread(block.data(), sizeof(Record), recordsPerBlock, in)) > 0) {
+            countIO++;
+            if (shard_writer) {
+                shard_writer->write(block.data(), read_count);
+            } else {
+                fwrite(block.data(), sizeof(Record), read_count, out);
+                countIO++;
+                context.outputWritten(copied, block.data(), read_count);
+            }
+            copied += read_count;
+        }
+        fclose(in);
+        if (!manifest) remove(runFileName(run).c_str());
+    }
+    if (shard_writer) {
+        shard_writer->close();
+    } else if (manifest) {
+        fflush(out);
+        fsync(fileno(out));
+    }
+    if (manifest) {
+        manifest->finish();
+        removeRuns(0, order.size());
+    }
+    if (out) fclose(out);
+}
+
+
+// Mezcla los tramos 0, ..., num_runs - 1 en outputFile: mientras haya más de a tramos se mezclan grupos de a en tramos nuevos.
+// Un único tramo (entrada ya ordenada) pasa a ser la salida sin copiarlo, y tramos de rangos disjuntos (por ejemplo, de una
+// entrada descendente) se concatenan en orden en una sola pasada
+// Con checkpoints la aridad se anota al empezar y cada tramo intermedio al terminarlo: al retomar se repiten las mismas
+// pasadas saltando los tramos ya anotados que se verifican
+template <typename Record, typename KeyFn, typename Compare>
+void ExternalSorter<Record, KeyFn, Compare>::mergeRuns(const std::string& outputFile, int num_runs) {
+    // Si la mezcla ya había empezado, los tramos iniciales ya mezclados no existen: se sigue con la aridad anotada
+    bool merge_started = manifest && manifest->fanIn > 0;
+    if (num_runs == 1 && !merge_started && numShards > 1) {
+        concatenateRuns(outputFile, {0});  // con shards el tramo se reparte (no se renombra)
+        return;
+    }
+    if (num_runs == 1 && !merge_started) {
+        std::error_code error;
+        std::filesystem::rename(runFileName(0), outputFile, error);
+        if (!error) {
+            if (manifest) manifest->finish();
+            return;
+        }
+    }
+    if (num_runs > 1 && (int)runBounds.size() == num_runs && !merge_started) {
+        std::vector<int> order(num_runs);
+        for (int i = 0; i < num_runs; i++) order[i] = i;
+        std::sort(order.begin(), order.end(), [this](int x, int y) { return less(runBounds[x].first, runBounds[y].first); });
+        bool disjoint = true;
+        for (int i = 1; i < num_runs && disjoint; i++) {
+            const Record& previous_last = runBounds[order[i - 1]].second;
+            const Record& first = runBounds[order[i]].first;
+            disjoint = mergeOperator == MergeOperator::NONE ? !less(first, previous_last) : less(previous_last, first);
+        }
+        if (disjoint) {
+            concatenateRuns(outputFile, order);
+            return;
+        }
+    }
+
+    // Tramos por mezcla: a, o los buffers de bloque (uno por tramo + el de salida) que quepan en la arena si el gobernador adapta
+    int fan_in = a;
+    if (merge_started) {
+        fan_in = manifest->fanIn;
+    } else {
+        if (memory_governor.adapts()) {
+            size_t block_bytes = (recordsPerBlock * sizeof(Record) + MemoryGovernor::ALIGNMENT - 1) / MemoryGovernor::ALIGNMENT * MemoryGovernor::ALIGNMENT;
+            fan_in = (int)std::clamp<size_t>(memory_governor.available() / block_bytes - 1, 2, a);
+        }
+        if (manifest) manifest->recordFanIn(fan_in);
+    }
+
+    int first_run = 0, next_run = num_runs;
+    while (num_runs > fan_in) {
+        int first_new_run = next_run;
+        for (int group = first_run; group < first_run + num_runs; group += fan_in) {
+            int group_runs = std::min(fan_in, first_run + num_runs - group);
+            int output_run = next_run++;
+            if (merge_started && manifest->merged.count(output_run)
+                && verifyRun(runFileName(output_run), sizeof(Record), manifest->merged[output_run])) {
+                removeRuns(group, group_runs);  // mezcla hecha antes de morir (sus tramos pueden no haberse borrado)
+                continue;
+            }
+            mergeFiles(runFileName(output_run).c_str(), group, group_runs, output_run);
+        }
+        first_run = first_new_run;
+        num_runs = next_run - first_new_run;
+        int passes_left = 1;
+        for (int runs = num_runs; runs > fan_in; runs = (runs + fan_in - 1) / fan_in) passes_left++;
+        context.mergePass(passes_left);
+    }
+    mergeFiles(outputFile.c_str(), first_run, num_runs, -1);
+}
+
+
+template <typename Record, typename KeyFn, typename Compare>
+long long ExternalSorter<Record, KeyFn, Compare>::mergesort(const std::string& inputFile, const std::string& outputFile) {
+    /* Mergesort externo: tramos iniciales de tamaño M y mezclas a-arias (en varias pasadas si hay más de a tramos).
+    Con setMergeOperator(DISTINCT) la salida tiene un registro por llave y con COUNT es un archivo de pares KeyCount<Key>.
+    Con setCheckpoint(true) retoma un ordenamiento interrumpido de la misma entrada y parámetros desde su manifiesto
+    args:
+        inputFile: nombre del archivo de entrada
+        outputFile: nombre del archivo de salida
+    returns:
+        countIO: número de operaciones de E/S (al retomar, incluye las lecturas de verificación de los tramos)
+    */
+
+    std::cout << "Iniciando ordenamiento externo..." << std::endl;
+    std::cout << "Tamaño de tramo en memoria (M): " << recordsInMemory << " registros (" << (long long)recordsInMemory * sizeof(Record) / (1024*1024) << " MB)" << std::endl;
+    std::cout << "Tamaño de bloque de disco (B): " << recordsPerBlock << " registros (" << (long long)recordsPerBlock * sizeof(Record) / 1024 << " KB)" << std::endl;
+    std::cout << "Aridad (k/a): " << a << std::endl;
+    countIO = 0;
+
+    // Checkpoints: los tramos llevan el nombre de la salida (no chocan con otro ordenamiento) y se retoma si hay un manifiesto
+    // de la misma entrada y parámetros
+    SortManifest checkpoint_manifest;
+    long long first_record = 0;
+    int resumed_runs = 0, extendable_from = 0;
+    bool runs_done = false;
+    runBounds.clear();
+    shardSamples.clear();
+    manifest = nullptr;
+    if (checkpoint) {
+        runPrefix = outputFile + ".run_";
+        manifest = &checkpoint_manifest;
+        std::string manifest_path = outputFile + ".manifest";
+        std::error_code error;
+        SortManifest::Header header = {inputFile, (long long)std::filesystem::file_size(inputFile, error), (long)sizeof(Record),
+                                       B_SIZE, M_SIZE, a, (int)mergeOperator};
+        if (checkpoint_manifest.load(manifest_path) && checkpoint_manifest.header == header) {
+            checkpoint_manifest.reopen(manifest_path);
+            if (checkpoint_manifest.fanIn > 0) {
+                runs_done = true;  // la mezcla ya empezó: sus tramos se verifican al mezclar
+                resumed_runs = checkpoint_manifest.completedRuns;
+            } else {
+                resumed_runs = resumeInitialRuns(first_record, extendable_from);
+                runs_done = resumed_runs == checkpoint_manifest.completedRuns;
+            }
+            std::cout << "Retomando desde el manifiesto: " << resumed_runs << " tramos " << (runs_done ? "completos" : "verificados")
+                      << (checkpoint_manifest.fanIn > 0 ? ", mezcla en curso" : "") << std::endl;
+        } else {
+            checkpoint_manifest.create(manifest_path, header);
+        }
+    }
+
+    memory_governor.beginPhase("mergesort: tramos iniciales");
+    context.enterPhase(false);
+    int actual_num_runs = runs_done ? resumed_runs : createInitialRuns(inputFile.c_str(), first_record, resumed_runs, extendable_from);
+    if (manifest && !runs_done) manifest->recordRuns(actual_num_runs);
+    chooseSplitters(inputFile);
+    memory_governor.beginPhase("mergesort: mezcla");
+    context.enterPhase(true);
+    std::cout << "Fase de creación de tramos iniciales completada. Tramos creados: " << actual_num_runs << std::endl;
+    std::cout << "Operaciones de E/S hasta ahora: " << countIO << std::endl;
+
+    // Si createInitialRuns devuelve 0 tramos (ej. archivo de entrada vacío), no hay nada que mezclar.
+    withFenceIndex(outputFile, [&] {
+        if (actual_num_runs > 0) {
+            if (countsKeys()) {
+                // Los tramos son pares (llave, conteo): los mezcla un sorter de pares que suma los conteos
+                ExternalSorter<KeyCount<Key>, KeyCountKey, Compare> counter(B_SIZE, M_SIZE, a, KeyCountKey(), comp);
+                counter.mergeOperator = MergeOperator::COUNT;
+                counter.runPrefix = runPrefix;
+                counter.manifest = manifest;
+                counter.numShards = numShards;
+                counter.shardSplitters = shardSplitters;
+                counter.fenceBlocks = fenceBlocks;
+                counter.withFenceIndex(outputFile, [&] { counter.mergeRuns(outputFile, actual_num_runs); });
+                countIO += counter.countIO;
+            } else {
+                mergeRuns(outputFile, actual_num_runs);
+            }
+            std::cout << "Fase de mezcla completada." << std::endl;
+        } else {
+            std::cout << "No se crearon tramos iniciales (posiblemente archivo de entrada vacío). Creando archivo de salida vacío." << std::endl;
+            if (numShards > 1) {
+                ShardWriter(*this, outputFile).close();  // shards vacíos y su índice
+            } else {
+                FILE* out = openFile(outputFile.c_str(), "wb"); // Crea un archivo de salida vacío
+                fclose(out);
+            }
+            if (manifest) manifest->finish();
+        }
+    });
+    manifest = nullptr;
+    memory_governor.endPhase();
+    std::cout << "Ordenamiento externo finalizado." << std::endl;
+    std::cout << "Total de operaciones de E/S (aproximado): " << countIO << std::endl;
+
+    return countIO;
+}
+
+// --------------------------------- Mezcla de archivos ya ordenados ---------------------------------
+
+// Una pasada de mezcla de archivos ordenados: cada archivo y la salida reciben una parte igual de M (en bloques completos),
+// así que cada lectura trae varios bloques. Con validate se revisa que cada archivo venga ordenado a medida que se lee
+// (dentro de cada buffer y contra el último registro del buffer anterior); retorna false en la primera inversión
+template <typename Record, typename KeyFn, typename Compare>
+bool ExternalSorter<Record, KeyFn, Compare>::mergeSortedPass(const std::vector<std::string>& inputs, const std::string& outputFile,
+                                                             bool final_output, bool validate) {
+    long available = M_SIZE;
+    if (memory_governor.adapts()) available = std::min<long>(available, memory_governor.available());
+    long bufferRecords = std::max(1L, available / (long)sizeof(Record) / recordsPerBlock / (long)(inputs.size() + 1)) * recordsPerBlock;
+    auto blocksOf = [this](size_t records) { return (long long)((records + recordsPerBlock - 1) / recordsPerBlock); };
+
+    struct InputReader {
+        FILE* file = nullptr;
+        ArenaVector<Record> buffer;
+        size_t position = 0;
+        long long consumed = 0;  // registros leídos antes del buffer actual
+    };
+    struct HeapNode {
+        Record record;
+        int i;
+    };
+    auto heap_greater = [this](const HeapNode& x, const HeapNode& y) { return less(y.record, x.record); };
+    std::priority_queue<HeapNode, std::vector<HeapNode>, decltype(heap_greater)> min_heap(heap_greater);
+    std::vector<InputReader> readers(inputs.size());
+    bool sorted = true;
+
+    // Lee el siguiente buffer del archivo i; retorna false si se terminó o si no viene ordenado
+    auto refill = [&](int i) {
+        InputReader& reader = readers[i];
+        bool has_previous = !reader.buffer.empty();
+        Record previous = has_previous ? reader.buffer.back() : Record();
+        reader.consumed += reader.buffer.size();
+        reader.buffer.resize(bufferRecords);
+        reader.buffer.resize(fread(reader.buffer.data(), sizeof(Record), bufferRecords, reader.file));
+        reader.position = 0;
+        countIO += blocksOf(reader.buffer.size());
+        if (reader.buffer.empty()) return false;
+        if (validate) {
+            auto run_less = [this](const Record& x, const Record& y) { return less(x, y); };
+            long inversion = has_previous && less(reader.buffer[0], previous)
+                             ? 0 : std::is_sorted_until(reader.buffer.begin(), reader.buffer.end(), run_less) - reader.buffer.begin();
+            if (inversion < (long)reader.buffer.size()) {
+                std::cerr << "Error: " << inputs[i] << " is not sorted (record " << reader.consumed + inversion << ")" << std::endl;
+                sorted = false;
+                return false;
+            }
+        }
+        return true;
+    };
+
+    for (size_t i = 0; i < inputs.size(); ++i) {
+        readers[i].file = openFile(inputs[i].c_str(), "rb");
+        if (refill(i)) min_heap.push({readers[i].buffer[readers[i].position++], (int)i});
+    }
+
+    FILE* out = openFile(outputFile.c_str(), "wb");
+    ArenaVector<Record> output_buffer(bufferRecords);
+    long output_buffer_pos = 0;
+    long long written = 0;
+    auto write_buffer = [&] {
+        fwrite(output_buffer.data(), sizeof(Record), output_buffer_pos, out);
+        countIO += blocksOf(output_buffer_pos);
+        if (final_output) context.outputWritten(written, output_buffer.data(), output_buffer_pos);
+        written += output_buffer_pos;
+        output_buffer_pos = 0;
+    };
+
+    while (sorted && !min_heap.empty()) {
+        HeapNode root = min_heap.top();
+        min_heap.pop();
+
+        // Con DISTINCT, igual que en mergeFiles: el buffer se escribe recién cuando llega otra llave y ya no hay espacio
+        if (mergeOperator != MergeOperator::NONE && output_buffer_pos > 0 && sameKey(output_buffer[output_buffer_pos - 1], root.record)) {
+            combine(output_buffer[output_buffer_pos - 1], root.record);
+        } else {
+            if (output_buffer_pos == bufferRecords) write_buffer();
+            output_buffer[output_buffer_pos++] = root.record;
+        }
+
+        InputReader& reader = readers[root.i];
+        if (reader.position < reader.buffer.size() || refill(root.i)) {
+            min_heap.push({reader.buffer[reader.position++], root.i});
+        }
+    }
+    if (sorted && output_buffer_pos > 0) write_buffer();
+
+    for (InputReader& reader : readers) fclose(reader.file);
+    fclose(out);
+    return sorted;
+}
+
+
+template <typename Record, typename KeyFn, typename Compare>
+long long ExternalSorter<Record, KeyFn, Compare>::mergeSorted(const std::vector<std::string>& inputFiles, const std::string& outputFile) {
+    /* Mezcla archivos que ya vienen ordenados (por ejemplo, shards de logs por servidor) sin formar tramos: una pasada de
+    lectura y una de escritura en vez de las tres del mergesort. Si hay más archivos de los que caben en M con un bloque
+    cada uno, se mezclan por grupos en pasadas intermedias. El orden de cada archivo se revisa mientras se lee; si uno no
+    viene ordenado, se borran la salida y los temporales y el programa termina con error (hay que ordenarlo con mergesort).
+    Con DISTINCT se deja un registro por llave; COUNT no aplica (la salida de COUNT es de pares, no de registros)
+    args:
+        inputFiles: archivos ordenados según KeyFn y Compare (no se modifican)
+        outputFile: nombre del archivo de salida
+    returns:
+        countIO: número de operaciones de E/S (una por bloque leído o escrito)
+    */
+
+    if (countsKeys()) {
+        std::cerr << "Error: mergeSorted does not support MergeOperator::COUNT" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    countIO = 0;
+    memory_governor.beginPhase("merge de archivos ordenados");
+    // Archivos por mezcla: los que caben en M con un bloque cada uno, más el de salida
+    long available = M_SIZE;
+    if (memory_governor.adapts()) available = std::min<long>(available, memory_governor.available());
+    size_t fan_in = std::max(2L, available / (long)sizeof(Record) / recordsPerBlock - 1);
+
+    std::vector<std::string> files = inputFiles;
+    std::vector<std::string> temporaries;
+    auto fail = [&] {
+        for (const std::string& file : temporaries) std::filesystem::remove(file);
+        std::filesystem::remove(outputFile);
+        exit(EXIT_FAILURE);
+    };
+    // Pasadas intermedias (solo la primera lee los archivos de entrada, y solo esa valida)
+    for (int pass = 0; files.size() > fan_in; ++pass) {
+        std::vector<std::string> merged;
+        for (size_t group = 0; group < files.size(); group += fan_in) {
+            std::vector<std::string> inputs(files.begin() + group, files.begin() + std::min(files.size(), group + fan_in));
+            std::string output = context.tempName("merge" + std::to_string(pass) + "_" + std::to_string(merged.size()));
+            temporaries.push_back(output);
+            if (!mergeSortedPass(inputs, output, false, pass == 0)) fail();
+            if (pass > 0) {
+                for (const std::string& file : inputs) std::filesystem::remove(file);
+            }
+            merged.push_back(output);
+        }
+        files = merged;
+    }
+    bool validate = files == inputFiles;
+    withFenceIndex(outputFile, [&] {
+        if (!mergeSortedPass(files, outputFile, true, validate)) fail();
+    });
+    if (!validate) {
+        for (const std::string& file : files) std::filesystem::remove(file);
+    }
+    memory_governor.endPhase();
+    return countIO;
+}
+
+// --------------------------------- Ordenamiento llave/puntero ---------------------------------
+
+template <typename Record, typename KeyFn, typename Compare>
+long long ExternalSorter<Record, KeyFn, Compare>::keyPointerSort(const std::string& inputFile, const std::string& outputFile) {
+    /* Ordenamiento llave/puntero para registros anchos: se extraen los pares (llave, id), se ordenan con el mergesort externo
+    y al final se aplica la permutación al archivo de registros en una sola pasada. La pasada final toma lotes de pares que
+    caben en M, los recorre en orden de id (es decir, en orden de bloque del input) y ubica cada registro en su posición del lote
+    args:
+        inputFile: nombre del archivo de registros
+        outputFile: nombre del archivo de salida
+    returns:
+        countIO: número de operaciones de E/S (incluye las del ordenamiento de los pares)
+    */
+
+    using Pair = KeyPointer<Key>;
+    countIO = 0;
+    long N_SIZE = countRecords(inputFile);
+    long pairsPerBlock = std::max(1L, B_SIZE / (long)sizeof(Pair));
+    std::string keysFile = context.tempName("keys");
+    std::string sortedKeysFile = context.tempName("keys.sorted");
+
+    // 1) Extraer los pares (llave, id) leyendo los registros por bloques
+    {
+        FILE* in = openFile(inputFile.c_str(), "rb");
+        FILE* out = openFile(keysFile.c_str(), "wb");
+        ArenaVector<Record> block(recordsPerBlock);
+        ArenaVector<Pair> pairs;
+        pairs.reserve(pairsPerBlock);
+        for (long read = 0; read < N_SIZE; ) {
+            size_t numRead = fread(block.data(), sizeof(Record), std::min(recordsPerBlock, N_SIZE - read), in);
+            if (numRead == 0) break;
+            countIO++;
+            for (size_t i = 0; i < numRead; ++i) {
+                pairs.push_back({key(block[i]), static_cast<std::uint64_t>(read + i)});
+                if ((long)pairs.size() == pairsPerBlock) {
+                    fwrite(pairs.data(), sizeof(Pair), pairs.size(), out);
+                    countIO++;
+                    pairs.clear();
+                }
+            }
+            read += numRead;
+        }
+        if (!pairs.empty()) {
+            fwrite(pairs.data(), sizeof(Pair), pairs.size(), out);
+            countIO++;
+        }
+        fclose(out);
+        fclose(in);
+    }
+
+    // 2) Ordenar solo los pares con el mergesort externo
+    ExternalSorter<Pair, IdentityKey<Pair>, KeyPointerLess<Compare>> pairSorter(B_SIZE, M_SIZE, a, IdentityKey<Pair>(), KeyPointerLess<Compare>{comp});
+    countIO += pairSorter.mergesort(keysFile, sortedKeysFile);
+    std::filesystem::remove(keysFile);
+
+    // 3) Aplicar la permutación por lotes: cada lote ocupa un registro de salida, un par y un índice por elemento, en lo que
+    // queda de M después del bloque del input (con arena, lo que queda libre; cada buffer se redondea a ALIGNMENT)
+    FILE* sortedKeys = openFile(sortedKeysFile.c_str(), "rb");
+    FILE* in = openFile(inputFile.c_str(), "rb");
+    FILE* out = openFile(outputFile.c_str(), "wb");
+    ArenaVector<Record> window(recordsPerBlock);  // bloque del input que se tiene en memoria
+    long windowFirst = -1, windowCount = 0;
+    size_t batchBytes = M_SIZE - std::min<size_t>(M_SIZE, MemoryGovernor::roundUp(recordsPerBlock * sizeof(Record)));
+    if (memory_governor.currentPolicy() != MemoryGovernor::UNLIMITED) batchBytes = std::min(batchBytes, memory_governor.available());
+    batchBytes -= std::min(batchBytes, 3 * MemoryGovernor::ALIGNMENT);
+    long batchSize = std::max(1L, (long)(batchBytes / (sizeof(Record) + sizeof(Pair) + sizeof(long))));
+    ArenaVector<Pair> batch;
+    ArenaVector<long> gatherOrder;
+    ArenaVector<Record> outputRecords;
+
+    for (long done = 0; done < N_SIZE; done += batch.size()) {
+        // Leer el siguiente lote de pares ordenados por bloques
+        batch.resize(std::min(batchSize, N_SIZE - done));
+        for (long read = 0; read < (long)batch.size(); ) {
+            size_t numRead = fread(batch.data() + read, sizeof(Pair), std::min(pairsPerBlock, (long)batch.size() - read), sortedKeys);
+            if (numRead == 0) break;
+            countIO++;
+            read += numRead;
+        }
+
+        // Recorrer el lote en orden de id: los registros se leen en orden de bloque y cada bloque una sola vez por lote
+        gatherOrder.resize(batch.size());
+        for (size_t i = 0; i < batch.size(); ++i) gatherOrder[i] = i;
+        std::sort(gatherOrder.begin(), gatherOrder.end(), [&batch](long x, long y) { return batch[x].id < batch[y].id; });
+
+        outputRecords.resize(batch.size());
+        for (long slot : gatherOrder) {
+            long id = batch[slot].id;
+            if (id < windowFirst || id >= windowFirst + windowCount) {
+                windowFirst = id / recordsPerBlock * recordsPerBlock;
+                fseek(in, windowFirst * (long)sizeof(Record), SEEK_SET);
+                windowCount = fread(window.data(), sizeof(Record), recordsPerBlock, in);
+                countIO++;
+            }
+            outputRecords[slot] = window[id - windowFirst];
+        }
+
+        // El lote ya está en el orden final: se escribe secuencialmente
+        for (long written = 0; written < (long)outputRecords.size(); written += recordsPerBlock) {
+            fwrite(outputRecords.data() + written, sizeof(Record), std::min(recordsPerBlock, (long)outputRecords.size() - written), out);
+            countIO++;
+        }
+    }
+    fclose(out);
+    fclose(in);
+    fclose(sortedKeys);
+    std::filesystem::remove(sortedKeysFile);
+    return countIO;
+}
+
+// --------------------------------- Quicksort externo ---------------------------------
+
+template <typename Record, typename KeyFn, typename Compare>
+int ExternalSorter<Record, KeyFn, Compare>::presortedDirection(const std::string& inputFile, long N_SIZE) {
+    /* Recorre el archivo por bloques mientras siga en orden ascendente o descendente; se detiene al encontrar una inversión
+    de ambos órdenes (en una entrada aleatoria, dentro del primer bloque)
+    args:
+        inputFile: nombre del archivo
+        N_SIZE: número de registros del archivo
+    returns:
+        1 si está en orden ascendente, -1 si está en orden descendente, 0 si no
+    */
+
+    FILE* file = openFile(inputFile.c_str(), "rb");
+    ArenaVector<Record> block(recordsPerBlock);
+    bool ascending = true, descending = true;
+    Record previous{};
+    for (long read = 0; (ascending || descending) && read < N_SIZE; ) {
+        size_t numRead = fread(block.data(), sizeof(Record), std::min(recordsPerBlock, N_SIZE - read), file);
+        if (numRead == 0) break;
+        countIO++;
+        for (size_t i = 0; i < numRead && (ascending || descending); ++i) {
+            if (read + (long)i > 0) {
+                if (less(block[i], previous)) ascending = false;
+                if (less(previous, block[i])) descending = false;
+            }
+            previous = block[i];
+        }
+        read += numRead;
+    }
+    fclose(file);
+    return ascending ? 1 : descending ? -1 : 0;
+}
+
+
+template <typename Record, typename KeyFn, typename Compare>
+void ExternalSorter<Record, KeyFn, Compare>::reverseInPlace(FILE* file, long N_SIZE) {
+    /* Invierte el archivo en el lugar: intercambia bloques de los dos extremos hacia el centro, invirtiendo cada uno
+    args:
+        file: archivo abierto en modo lectura/escritura
+        N_SIZE: número de registros del archivo
+    returns:
+        void
+    */
+
+    long lo = 0, hi = N_SIZE;
+    ArenaVector<Record> front(recordsPerBlock), back(recordsPerBlock);
+    while (hi - lo >= 2 * recordsPerBlock) {
+        fseek(file, lo * (long)sizeof(Record), SEEK_SET);
+        size_t _ = fread(front.data(), sizeof(Record), recordsPerBlock, file);
+        fseek(file, (hi - recordsPerBlock) * (long)sizeof(Record), SEEK_SET);
+        _ = fread(back.data(), sizeof(Record), recordsPerBlock, file);
+        countIO += 2;
+        std::reverse(front.begin(), front.end());
+        std::reverse(back.begin(), back.end());
+        writeRecords(file, lo, back.data(), recordsPerBlock);
+        writeRecords(file, hi - recordsPerBlock, front.data(), recordsPerBlock);
+        lo += recordsPerBlock;
+        hi -= recordsPerBlock;
+    }
+    // Centro: menos de dos bloques
+    if (hi > lo) {
+        ArenaVector<Record> middle(hi - lo);
+        fseek(file, lo * (long)sizeof(Record), SEEK_SET);
+        size_t _ = fread(middle.data(), sizeof(Record), hi - lo, file);
+        countIO += (hi - lo + recordsPerBlock - 1) / recordsPerBlock;
+        std::reverse(middle.begin(), middle.end());
+        writeRecords(file, lo, middle.data(), hi - lo);
+    }
+}
+
+
+template <typename Record, typename KeyFn, typename Compare>
+void ExternalSorter<Record, KeyFn, Compare>::quicksortLevel(const std::string& inputFile, const QuicksortTask& task, FILE* output,
+                                                            std::vector<QuicksortTask>& tasks, long& nextTaskId) {
+    /* Procesa una partición del quicksort genérico: la ordena en memoria si cabe en M, o la distribuye según a-1 pivotes
+    (llaves de un bloque aleatorio) en particiones de rango y de igualdad; las de igualdad ya quedan ordenadas por llave.
+    Solo se escriben los primeros task.limit registros: las particiones que quedan enteras después de ese límite se descartan
+    y solo se recursa en la que lo contiene (quickselect)
+    args:
+        inputFile: nombre del archivo de entrada (base de los nombres temporales, id 0 = el mismo archivo)
+        task: partición a procesar
+        output: archivo de salida final (el mismo archivo de entrada, abierto en modo lectura/escritura)
+        tasks: cola de particiones pendientes
+        nextTaskId: siguiente id libre para archivos temporales
+    returns:
+        void
+    */
+
+    std::string fileName = task.id == 0 ? inputFile : context.tempName("part" + std::to_string(task.id));
+    long N_SIZE = task.N_SIZE;
+
+    // Caso base: la partición cabe en memoria (en lo que queda de ella con ADAPT)
+    long fitting = recordsInMemory;
+    if (memory_governor.adapts()) fitting = std::min<long>(fitting, memory_governor.available() / sizeof(Record));
+    if (N_SIZE <= fitting) {
+        ArenaVector<Record> buffer;
+        readRecords(fileName, buffer, N_SIZE);
+        sortRecords(buffer, task.limit);
+        writeRecords(output, task.outputOffset, buffer.data(), std::min(N_SIZE, task.limit));
+        if (task.id != 0) std::filesystem::remove(fileName);
+        return;
+    }
+
+    // 1) y 2) Pivotes: llaves distintas de un bloque aleatorio, ordenadas
+    FILE* file = openFile(fileName.c_str(), "rb");
+    long blockCount = (N_SIZE + recordsPerBlock - 1) / recordsPerBlock;
+    ArenaVector<Record> block(recordsPerBlock);
+    fseek(file, context.random(blockCount) * recordsPerBlock * (long)sizeof(Record), SEEK_SET);
+    block.resize(fread(block.data(), sizeof(Record), recordsPerBlock, file));
+    countIO++;
+    std::vector<Key> pivots;
+    for (int i = 0; i < a - 1 && !block.empty(); ++i) {
+        pivots.push_back(key(block[context.random(block.size())]));
+    }
+    std::sort(pivots.begin(), pivots.end(), comp);
+    pivots.erase(std::unique(pivots.begin(), pivots.end(), [this](const Key& x, const Key& y) { return !comp(x, y) && !comp(y, x); }), pivots.end());
+    ArenaVector<Record>().swap(block);
+    // Con ADAPT se usan menos pivotes si los buffers de bloque de las particiones más el de lectura no caben en lo que queda de M
+    if (memory_governor.adapts()) {
+        size_t block_bytes = recordsPerBlock * sizeof(Record);
+        while (pivots.size() > 1 && (2 * pivots.size() + 2) * block_bytes > memory_governor.available()) pivots.pop_back();
+    }
+
+    // Particiones en orden de salida: rango 0, igual a pivote 0, rango 1, igual a pivote 1, ..., rango k
+    int numPivots = pivots.size();
+    int numPartitions = 2 * numPivots + 1;
+    long firstChildId = nextTaskId;
+    nextTaskId += numPartitions;
+    std::vector<FILE*> partitionHandles(numPartitions, nullptr);
+    std::vector<ArenaVector<Record>> partitionBuffers(numPartitions);
+    std::vector<long> partitionSizes(numPartitions, 0);
+    auto partitionFile = [&](int p) { return context.tempName("part" + std::to_string(firstChildId + p)); };
+
+    // 3) Distribuir por bloques
+    fseek(file, 0, SEEK_SET);
+    ArenaVector<Record> currentBlock(recordsPerBlock);
+    for (long read = 0; read < N_SIZE; ) {
+        size_t numRead = fread(currentBlock.data(), sizeof(Record), std::min(recordsPerBlock, N_SIZE - read), file);
+        if (numRead == 0) break;
+        countIO++;
+        read += numRead;
+
+        for (size_t i = 0; i < numRead; ++i) {
+            const Key& k = key(currentBlock[i]);
+            int range = std::upper_bound(pivots.begin(), pivots.end(), k, comp) - pivots.begin();
+            bool equal = range > 0 && !comp(pivots[range - 1], k);
+            int p = equal ? 2 * range - 1 : 2 * range;
+            if (partitionBuffers[p].capacity() == 0) partitionBuffers[p].reserve(recordsPerBlock);
+            partitionBuffers[p].push_back(currentBlock[i]);
+            partitionSizes[p]++;
+            if ((long)partitionBuffers[p].size() == recordsPerBlock) {
+                if (!partitionHandles[p]) partitionHandles[p] = openFile(partitionFile(p).c_str(), "wb");
+                fwrite(partitionBuffers[p].data(), sizeof(Record), recordsPerBlock, partitionHandles[p]);
+                countIO++;
+                partitionBuffers[p].clear();
+            }
+        }
+    }
+    fclose(file);
+    if (task.id != 0) std::filesystem::remove(fileName);
+    ArenaVector<Record>().swap(currentBlock);
+
+    // 4) Posición de cada partición en la salida y registros que se necesitan de ella (los que caen antes del límite de la tarea)
+    std::vector<long> partitionOffsets(numPartitions);
+    std::vector<long> partitionNeeded(numPartitions);
+    long cursor = task.outputOffset;
+    for (int p = 0; p < numPartitions; ++p) {
+        partitionOffsets[p] = cursor;
+        partitionNeeded[p] = std::clamp(task.outputOffset + task.limit - cursor, 0L, partitionSizes[p]);
+        cursor += partitionSizes[p];
+    }
+
+    // 5) Las particiones que nunca tocaron disco se ordenan y escriben directo, y las volcadas terminan de volcarse;
+    // todos los buffers se liberan antes de leer particiones de disco, que así tienen M completa
+    for (int p = 0; p < numPartitions; ++p) {
+        bool equalityPartition = p % 2 == 1;
+        if (partitionHandles[p]) {
+            if (partitionNeeded[p] > 0 && !partitionBuffers[p].empty()) {
+                fwrite(partitionBuffers[p].data(), sizeof(Record), partitionBuffers[p].size(), partitionHandles[p]);
+                countIO++;
+            }
+            fclose(partitionHandles[p]);
+            if (partitionNeeded[p] == 0) std::filesystem::remove(partitionFile(p));
+        } else if (partitionNeeded[p] > 0) {
+            if (!equalityPartition) sortRecords(partitionBuffers[p], partitionNeeded[p]);
+            writeRecords(output, partitionOffsets[p], partitionBuffers[p].data(), partitionNeeded[p]);
+        }
+        ArenaVector<Record>().swap(partitionBuffers[p]);
+    }
+
+    // 6) Particiones volcadas: las de igualdad ya están ordenadas y se copian de a un bloque (con pocas llaves distintas
+    // pueden ser casi toda la entrada), las de rango que caben en M se ordenan en memoria y el resto pasa a la cola
+    for (int p = 0; p < numPartitions; ++p) {
+        if (!partitionHandles[p] || partitionNeeded[p] == 0) continue;
+        if (memory_governor.adapts()) fitting = std::min<long>(recordsInMemory, memory_governor.available() / sizeof(Record));
+        if (p % 2 == 1) {
+            copyRecords(partitionFile(p), output, partitionOffsets[p], partitionNeeded[p]);
+            std::filesystem::remove(partitionFile(p));
+        } else if (partitionSizes[p] <= fitting) {
+            ArenaVector<Record> buffer;
+            readRecords(partitionFile(p), buffer, partitionSizes[p]);
+            sortRecords(buffer, partitionNeeded[p]);
+            writeRecords(output, partitionOffsets[p], buffer.data(), partitionNeeded[p]);
+            std::filesystem::remove(partitionFile(p));
+        } else {
+            tasks.push_back({firstChildId + p, partitionSizes[p], partitionOffsets[p], partitionNeeded[p]});
+        }
+    }
+}
+
+
+template <typename Record, typename KeyFn, typename Compare>
+long long ExternalSorter<Record, KeyFn, Compare>::quicksort(const std::string& inputFile, long N_SIZE) {
+    /* Quicksort externo en el lugar. Para llaves puras se usa el motor afinado de quicksort_v3_args.cpp
+    (buckets de igualdad por conteo, empaquetado de particiones, clasificación en paralelo).
+    Si la entrada ya está ordenada termina tras una pasada de lectura, y si está en orden descendente solo se invierte
+    args:
+        inputFile: nombre del archivo a ordenar
+        N_SIZE: número de registros del archivo
+    returns:
+        countIO: número de operaciones de E/S
+    */
+
+    countIO = 0;
+    withFenceIndex(inputFile, [&] {
+        if constexpr (pure_key) {
+            countIO = run_quicksort(context, inputFile, N_SIZE);
+        } else {
+            int direction = presortedDirection(inputFile, N_SIZE);
+            if (direction == 1) return;
+            FILE* output = openFile(inputFile.c_str(), "rb+");
+            if (direction == -1) {
+                reverseInPlace(output, N_SIZE);
+                fclose(output);
+                return;
+            }
+
+            memory_governor.beginPhase("quicksort");
+            std::vector<QuicksortTask> tasks = {{0, N_SIZE, 0, N_SIZE}};
+            long nextTaskId = 1;
+            while (!tasks.empty()) {
+                QuicksortTask task = tasks.back();  // profundidad primero
+                tasks.pop_back();
+                quicksortLevel(inputFile, task, output, tasks, nextTaskId);
+            }
+            fclose(output);
+            memory_governor.endPhase();
+        }
+    });
+    return countIO;
+}
+
+
+template <typename Record, typename KeyFn, typename Compare>
+long long ExternalSorter<Record, KeyFn, Compare>::topK(const std::string& inputFile, const std::string& outputFile, long K) {
+    /* Escribe en outputFile los K registros menores del archivo, ordenados. Si K cabe en M es una sola pasada de lectura
+    con un heap acotado a K registros; si no, es un quickselect externo sobre el particionado del quicksort que solo recursa
+    en las particiones antes del K-ésimo registro
+    args:
+        inputFile: nombre del archivo de entrada (no se modifica)
+        outputFile: nombre del archivo de salida
+        K: número de registros a conservar
+    returns:
+        countIO: número de operaciones de E/S
+    */
+
+    countIO = 0;
+    long N_SIZE = countRecords(inputFile);
+    K = std::clamp(K, 0L, N_SIZE);
+    FILE* output = openFile(outputFile.c_str(), "wb+");
+
+    if (K <= recordsInMemory) {
+        // Heap de máximos con los K menores vistos: la raíz es el que sale cuando llega uno menor
+        auto heapLess = [this](const Record& x, const Record& y) { return less(x, y); };
+        ArenaVector<Record> heap;
+        heap.reserve(K);
+        FILE* in = openFile(inputFile.c_str(), "rb");
+        ArenaVector<Record> block(recordsPerBlock);
+        size_t numRead;
+        while (K > 0 && (numRead = fread(block.data(), sizeof(Record), recordsPerBlock, in)) > 0) {
+            countIO++;
+            for (size_t i = 0; i < numRead; ++i) {
+                if ((long)heap.size() < K) {
+                    heap.push_back(block[i]);
+                    std::push_heap(heap.begin(), heap.end(), heapLess);
+                } else if (less(block[i], heap.front())) {
+                    std::pop_heap(heap.begin(), heap.end(), heapLess);
+                    heap.back() = block[i];
+                    std::push_heap(heap.begin(), heap.end(), heapLess);
+                }
+            }
+        }
+        fclose(in);
+        std::sort_heap(heap.begin(), heap.end(), heapLess);
+        writeRecords(output, 0, heap.data(), heap.size());
+    } else {
+        std::vector<QuicksortTask> tasks = {{0, N_SIZE, 0, K}};
+        long nextTaskId = 1;
+        while (!tasks.empty()) {
+            QuicksortTask task = tasks.back();
+            tasks.pop_back();
+            quicksortLevel(inputFile, task, output, tasks, nextTaskId);
+        }
+    }
+    fclose(output);
+    return countIO;
+}
+
+// --------------------------------- Radix sort externo (MSD) ---------------------------------
+
+template <typename Record, typename KeyFn, typename Compare>
+std::uint64_t ExternalSorter<Record, KeyFn, Compare>::radixKey(const Record& record) const {
+    /* Llave sin signo de 64 bits que conserva el orden de la llave (en llaves con signo se invierte el bit de signo)
+    args:
+        record: registro
+    returns:
+        llave de 64 bits sin signo
+    */
+
+    Key k = key(record);
+    if constexpr (std::is_signed_v<Key>) {
+        return static_cast<std::uint64_t>(static_cast<std::int64_t>(k)) ^ (1ULL << 63);
+    } else {
+        return static_cast<std::uint64_t>(k);
+    }
+}
+
+
+template <typename Record, typename KeyFn, typename Compare>
+void ExternalSorter<Record, KeyFn, Compare>::radixLevel(const std::string& inputFile, const std::string& fileName, bool isInput, long N_SIZE,
+                                                        std::uint64_t minKey, std::uint64_t maxKey, int bits,
+                                                        FILE* output, long outputOffset, long& nextBucketId) {
+    /* Ordena el rango de llaves [minKey, maxKey] guardado en fileName y lo escribe en [outputOffset, outputOffset + N_SIZE) de la salida:
+    si cabe en M se ordena en memoria, si todas las llaves son iguales se copia tal cual, y si no se distribuye en 2^bits buckets
+    según los bits de la llave que siguen al primer bit en que difieren la mínima y la máxima (división adaptativa de buckets)
+    args:
+        inputFile: nombre del archivo de entrada del ordenamiento (base de los nombres temporales)
+        fileName: nombre del archivo con los registros del rango
+        isInput: true si fileName es el archivo de entrada (no se borra)
+        N_SIZE: número de registros del rango
+        minKey, maxKey: cotas de las llaves del rango
+        bits: bits por pasada (log2 del número de buckets)
+        output: archivo de salida final
+        outputOffset: posición (en registros) del rango en la salida
+        nextBucketId: contador para nombrar los archivos temporales de los buckets
+    returns:
+        void
+    */
+
+    // Todas las llaves iguales: no hay nada que ordenar (con llaves puras ni siquiera hay que leer)
+    if (minKey == maxKey) {
+        if constexpr (pure_key) {
+            ArenaVector<Record> repeated(std::min(N_SIZE, recordsPerBlock), static_cast<Record>(minKey ^ (1ULL << 63)));
+            for (long written = 0; written < N_SIZE; written += repeated.size()) {
+                writeRecords(output, outputOffset + written, repeated.data(), std::min((long)repeated.size(), N_SIZE - written));
+            }
+        } else {
+            copyRecords(fileName, output, outputOffset, N_SIZE);
+        }
+        if (!isInput) std::filesystem::remove(fileName);
+        return;
+    }
+
+    // Caso base: Si los datos caben en lo que queda de la memoria principal, ordenar directamente en memoria (con arena se
+    // descuentan los buffers vivos en cualquier política: los de los buckets del nivel de arriba que esperan su turno)
+    long fitting = recordsInMemory;
+    if (memory_governor.currentPolicy() != MemoryGovernor::UNLIMITED) {
+        fitting = std::min<long>(fitting, memory_governor.available() / sizeof(Record));
+    }
+    if (N_SIZE <= fitting) {
+        ArenaVector<Record> buffer;
+        readRecords(fileName, buffer, N_SIZE);
+        sortRecords(buffer);
+        writeRecords(output, outputOffset, buffer.data(), N_SIZE);
+        if (!isInput) std::filesystem::remove(fileName);
+        return;
+    }
+
+    // 1) Elegir los bits de esta pasada: empiezan en el primer bit en que difieren la mínima y la máxima
+    // (con arena se usan menos buckets si sus buffers de bloque más el de lectura no caben en lo que queda de M)
+    if (memory_governor.currentPolicy() != MemoryGovernor::UNLIMITED) {
+        size_t block_bytes = recordsPerBlock * sizeof(Record);
+        while (bits > 1 && ((size_t(1) << bits) + 1) * block_bytes > memory_governor.available()) bits--;
+    }
+    int highestBit = 63 - __builtin_clzll(minKey ^ maxKey);
+    int shift = std::max(0, highestBit - bits + 1);
+    int numBuckets = 1 << bits;
+    std::uint64_t mask = numBuckets - 1;
+
+    std::vector<std::string> bucketFiles(numBuckets);
+    std::vector<FILE*> bucketHandles(numBuckets, nullptr);
+    std::vector<ArenaVector<Record>> bucketBuffers(numBuckets);
+    std::vector<long> bucketSizes(numBuckets, 0);
+    std::vector<std::uint64_t> bucketMin(numBuckets, UINT64_MAX);
+    std::vector<std::uint64_t> bucketMax(numBuckets, 0);
+    for (int i = 0; i < numBuckets; ++i) {
+        bucketFiles[i] = context.tempName("radix" + std::to_string(nextBucketId++));
+    }
+
+    // 2) y 3) Distribuir por bloques de tamaño B según el prefijo de la llave, guardando tamaño, mínima y máxima de cada bucket
+    ArenaVector<Record> block(recordsPerBlock);
+    FILE* file = openFile(fileName.c_str(), "rb");
+    for (long read = 0; read < N_SIZE; ) {
+        size_t numRead = fread(block.data(), sizeof(Record), std::min(recordsPerBlock, N_SIZE - read), file);
+        if (numRead == 0) break;  // el archivo tiene menos registros de los indicados
+        countIO++;
+        read += numRead;
+
+        for (size_t i = 0; i < numRead; ++i) {
+            std::uint64_t k = radixKey(block[i]);
+            int bucket = (k >> shift) & mask;
+            bucketBuffers[bucket].push_back(block[i]);
+            bucketSizes[bucket]++;
+            bucketMin[bucket] = std::min(bucketMin[bucket], k);
+            bucketMax[bucket] = std::max(bucketMax[bucket], k);
+
+            // Si el buffer del bucket alcanzó el tamaño de bloque, volcarlo
+            if ((long)bucketBuffers[bucket].size() == recordsPerBlock) {
+                if (!bucketHandles[bucket]) bucketHandles[bucket] = openFile(bucketFiles[bucket].c_str(), "wb");
+                fwrite(bucketBuffers[bucket].data(), sizeof(Record), recordsPerBlock, bucketHandles[bucket]);
+                countIO++;
+                bucketBuffers[bucket].clear();
+            }
+        }
+    }
+    fclose(file);
+    if (!isInput) std::filesystem::remove(fileName);
+
+    // Los buckets que nunca llenaron un bloque se quedan en memoria; el resto termina de volcarse
+    for (int i = 0; i < numBuckets; ++i) {
+        if (bucketHandles[i]) {
+            if (!bucketBuffers[i].empty()) {
+                fwrite(bucketBuffers[i].data(), sizeof(Record), bucketBuffers[i].size(), bucketHandles[i]);
+                countIO++;
+                bucketBuffers[i].clear();
+            }
+            fclose(bucketHandles[i]);
+            ArenaVector<Record>().swap(bucketBuffers[i]);  // el buffer ya volcado no se retiene durante la recursión
+        }
+    }
+    ArenaVector<Record>().swap(block);
+
+    // 4) Escribir cada bucket en su posición de la salida, en orden de prefijo
+    long cursor = outputOffset;
+    for (int i = 0; i < numBuckets; ++i) {
+        if (bucketSizes[i] == 0) continue;
+        if (bucketHandles[i]) {
+            radixLevel(inputFile, bucketFiles[i], false, bucketSizes[i], bucketMin[i], bucketMax[i], bits, output, cursor, nextBucketId);
+        } else {
+            sortRecords(bucketBuffers[i]);
+            writeRecords(output, cursor, bucketBuffers[i].data(), bucketSizes[i]);
+        }
+        cursor += bucketSizes[i];
+    }
+}
+
+
+template <typename Record, typename KeyFn, typename Compare>
+long long ExternalSorter<Record, KeyFn, Compare>::radixsort(const std::string& inputFile, const std::string& outputFile, long N_SIZE) {
+    /* Radix sort externo MSD sobre los bits más significativos de la llave (sin muestreo de pivotes ni comparaciones al distribuir)
+    args:
+        inputFile: nombre del archivo de entrada
+        outputFile: nombre del archivo de salida
+        N_SIZE: número de registros del archivo
+    returns:
+        countIO: número de operaciones de E/S
+    */
+
+    static_assert(radix_capable, "radixsort requiere una llave entera de hasta 64 bits en orden ascendente");
+    countIO = 0;
+
+    // Bits por pasada: la mayor potencia de 2 que no supera a a (al menos 2 buckets)
+    int bits = 1;
+    while ((2L << bits) <= a && bits < 16) bits++;
+
+    memory_governor.beginPhase("radix");
+    // Si el programa termina por exceder el presupuesto, no quedan los archivos de los buckets
+    long cleanup = memory_governor.addCleanup([this] { context.removeTemporaries(); });
+    withFenceIndex(outputFile, [&] {
+        FILE* output = openFile(outputFile.c_str(), "wb");
+        long nextBucketId = 0;
+        radixLevel(inputFile, inputFile, true, N_SIZE, 0, UINT64_MAX, bits, output, 0, nextBucketId);
+        fclose(output);
+    });
+    memory_governor.removeCleanup(cleanup);
+    memory_governor.endPhase();
+    return countIO;
+}
+
+// --------------------------------- Ordenamiento en streaming ---------------------------------
+
+// Ordenamiento sin archivos de entrada ni salida: el productor agrega registros con push(), y después de finish()
+// el consumidor los recibe ordenados con next() o forEach(). Si todo cabe en M se ordena solo en memoria;
+// cada vez que el buffer de M se llena se ordena y se vuelca como un tramo, y al final se mezclan los tramos con el buffer restante
+template <typename Record, typename KeyFn = IdentityKey<Record>, typename Compare = std::less<>>
+class StreamingSorter {
+    static_assert(std::is_trivially_copyable_v<Record>, "los registros se leen y escriben como bytes, deben ser trivialmente copiables");
+
+public:
+    // spillPrefix vacío: prefijo único del proceso (SortContext), así dos sorters no comparten tramos
+    StreamingSorter(long B_SIZE, long M_SIZE, int a, const std::string& spillPrefix = "",
+                    KeyFn key = KeyFn(), Compare comp = Compare())
+        : a(std::max(2, a)), spillPrefix(spillPrefix.empty() ? SortContext(B_SIZE, M_SIZE, a).tempName("stream") : spillPrefix), key(key), comp(comp),
+          recordsPerBlock(std::max(1L, B_SIZE / (long)sizeof(Record))),
+          recordsInMemory(std::max(1L, M_SIZE / (long)sizeof(Record))) {
+        // El buffer se reserva una sola vez: M, o lo que queda de la arena descontando los bloques de las mezclas de finish()
+        // (a lectores más el de salida mientras el buffer sigue vivo), para que no crezca duplicándose más allá de M
+        long long blockRecords = (long long)(this->a + 1) * recordsPerBlock;
+        long long fitting = std::min<long long>(recordsInMemory, memory_governor.available() / sizeof(Record));
+        bufferCapacity = std::max(1LL, fitting - blockRecords);
+        buffer.reserve(bufferCapacity);
+    }
+
+    ~StreamingSorter() {
+        for (RunReader& reader : readers) {
+            if (reader.file) fclose(reader.file);
+        }
+        for (const std::string& run : runs) std::filesystem::remove(run);
+    }
+
+    void push(const Record& record) {
+        /* Agrega un registro; si el buffer se llena, se ordena y se vuelca como un tramo
+        args:
+            record: registro a agregar
+        returns:
+            void
+        */
+
+        buffer.push_back(record);
+        if ((long long)buffer.size() == bufferCapacity) spillBuffer();
+    }
+
+    void finish() {
+        /* Termina la entrada: ordena el buffer restante y deja listos los tramos para leer la salida ordenada
+        returns:
+            void
+        */
+
+        std::sort(buffer.begin(), buffer.end(), [this](const Record& x, const Record& y) { return less(x, y); });
+        // La mezcla final usa un lector por tramo más el buffer en memoria: a lo más a - 1 tramos
+        while ((long)runs.size() > a - 1) mergeRunGroup();
+        for (const std::string& run : runs) {
+            readers.push_back({openFile(run.c_str(), "rb"), {}, 0});
+            refill(readers.back());
+        }
+        bufferPos = 0;
+    }
+
+    bool next(Record& record) {
+        /* Entrega el siguiente registro en orden (se debe haber llamado a finish())
+        args:
+            record: donde se copia el registro
+        returns:
+            false si ya no quedan registros
+        */
+
+        int best = -1;  // -1 = buffer en memoria, i >= 0 = tramo i
+        const Record* bestRecord = bufferPos < buffer.size() ? &buffer[bufferPos] : nullptr;
+        for (size_t i = 0; i < readers.size(); ++i) {
+            const RunReader& reader = readers[i];
+            if (reader.pos < reader.block.size() && (!bestRecord || less(reader.block[reader.pos], *bestRecord))) {
+                bestRecord = &reader.block[reader.pos];
+                best = i;
+            }
+        }
+        if (!bestRecord) return false;
+        record = *bestRecord;
+        if (best < 0) {
+            bufferPos++;
+        } else if (++readers[best].pos == readers[best].block.size()) {
+            refill(readers[best]);
+        }
+        return true;
+    }
+
+    template <typename Callback>
+    void forEach(Callback callback) {
+        /* Entrega todos los registros restantes en orden al callback
+        args:
+            callback: función que recibe cada registro (const Record&)
+        returns:
+            void
+        */
+
+        Record record;
+        while (next(record)) callback(record);
+    }
+
+    long long diskAccesses() const { return countIO; }
+    bool spilled() const { return !runs.empty(); }
+
+private:
+    struct RunReader {
+        FILE* file;
+        ArenaVector<Record> block;
+        size_t pos;
+    };
+
+    int a;
+    std::string spillPrefix;
+    KeyFn key;
+    Compare comp;
+    long recordsPerBlock;
+    long recordsInMemory;
+    long long countIO = 0;
+    long long bufferCapacity;         // registros del buffer en memoria (a lo más M)
+    ArenaVector<Record> buffer;
+    size_t bufferPos = 0;
+    std::vector<std::string> runs;    // tramos volcados a disco
+    std::vector<RunReader> readers;   // lectores de la mezcla final
+    long nextRunId = 0;
+
+    bool less(const Record& x, const Record& y) const { return comp(key(x), key(y)); }
+
+    std::string newRunName() { return spillPrefix + ".srun" + std::to_string(nextRunId++); }
+
+    // Abre un tramo o termina el programa si no se puede (p.ej. disco lleno o sin descriptores), como el resto del motor
+    static FILE* openFile(const char* fileName, const char* mode) { return ExternalSorter<Record, KeyFn, Compare>::openFile(fileName, mode); }
+
+    void writeBlocks(FILE* file, const Record* data, long numRecords) {
+        for (long written = 0; written < numRecords; written += recordsPerBlock) {
+            fwrite(data + written, sizeof(Record), std::min(recordsPerBlock, numRecords - written), file);
+            countIO++;
+        }
+    }
+
+    void refill(RunReader& reader) {
+        reader.block.resize(recordsPerBlock);
+        size_t numRead = fread(reader.block.data(), sizeof(Record), recordsPerBlock, reader.file);
+        if (numRead > 0) countIO++;
+        reader.block.resize(numRead);
+        reader.pos = 0;
+    }
+
+    void spillBuffer() {
+        // Ordena el buffer de M y lo vuelca como un tramo nuevo
+        std::sort(buffer.begin(), buffer.end(), [this](const Record& x, const Record& y) { return less(x, y); });
+        runs.push_back(newRunName());
+        FILE* file = openFile(runs.back().c_str(), "wb");
+        writeBlocks(file, buffer.data(), buffer.size());
+        fclose(file);
+        buffer.clear();
+    }
+
+    void mergeRunGroup() {
+        // Mezcla los primeros a tramos en uno nuevo (al final de la lista), con un bloque B por tramo
+        std::vector<RunReader> group;
+        for (int i = 0; i < a; ++i) {
+            group.push_back({openFile(runs[i].c_str(), "rb"), {}, 0});
+            refill(group.back());
+        }
+        std::string merged = newRunName();
+        FILE* out = openFile(merged.c_str(), "wb");
+        ArenaVector<Record> outputBlock;
+        outputBlock.reserve(recordsPerBlock);
+        while (true) {
+            int best = -1;
+            for (int i = 0; i < a; ++i) {
+                if (group[i].pos < group[i].block.size() && (best < 0 || less(group[i].block[group[i].pos], group[best].block[group[best].pos]))) {
+                    best = i;
+                }
+            }
+            if (best < 0) break;
+            outputBlock.push_back(group[best].block[group[best].pos]);
+            if (++group[best].pos == group[best].block.size()) refill(group[best]);
+            if ((long)outputBlock.size() == recordsPerBlock) {
+                writeBlocks(out, outputBlock.data(), outputBlock.size());
+                outputBlock.clear();
+            }
+        }
+        writeBlocks(out, outputBlock.data(), outputBlock.size());
+        fclose(out);
+        for (int i = 0; i < a; ++i) {
+            fclose(group[i].file);
+            std::filesystem::remove(runs[i]);
+        }
+        runs.erase(runs.begin(), runs.begin() + a);
+        runs.push_back(merged);
+    }
+};
+
+#endif
@@ -0,0 +1,245 @@
+// Índice disperso ("fence pointers") de un archivo ordenado: la primera llave de cada k-ésimo bloque, en un archivo aparte
+// (ordenado + ".fence"). Se arma mientras el ordenamiento escribe la salida final (ExternalSorter::setFenceIndex), así que
+// no cuesta lecturas extra, y FenceLookup lo usa para buscar rangos: una búsqueda binaria en memoria sobre las llaves del
+// índice elige el grupo de k bloques donde empieza el rango y se leen solo los bloques de ese grupo que hagan falta
+// (con k = 1, uno), con un cache LRU de bloques para las consultas repetidas o cercanas
+//
+// Formato: FenceIndexHeader seguido de las llaves (binario, tal como están en memoria)
+#ifndef FENCE_INDEX_HPP
+#define FENCE_INDEX_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <list>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+struct FenceIndexHeader {
+    char magic[8] = {'F', 'E', 'N', 'C', 'E', 'I', 'D', 'X'};
+    std::int64_t record_size = 0;        // bytes por registro del archivo ordenado
+    std::int64_t key_size = 0;           // bytes por llave del índice
+    std::int64_t records_per_block = 0;  // registros por bloque B
+    std::int64_t blocks_per_fence = 0;   // k: una llave cada k bloques
+    std::int64_t records = 0;            // registros del archivo ordenado
+};
+
+// Llaves del índice de una salida en construcción: las escrituras pueden llegar en cualquier orden (el quicksort escribe
+// cada partición en su posición), así que se guarda cada llave en su casilla y al final se piden las que falten
+template <typename Key>
+class FenceIndexBuilder {
+    static_assert(std::is_trivially_copyable_v<Key>, "las llaves del índice se guardan como bytes");
+
+public:
+    FenceIndexBuilder() = default;
+    FenceIndexBuilder(long records_per_block, long blocks_per_fence)
+        : recordsPerBlock(records_per_block), blocksPerFence(std::max(1L, blocks_per_fence)),
+          stride((long long)records_per_block * std::max(1L, blocks_per_fence)) {}
+
+    bool active() const { return stride > 0; }
+
+    // Registros data[0, count) escritos desde la posición offset de la salida
+    template <typename Record, typename KeyFn>
+    void add(long long offset, const Record* data, long count, const KeyFn& key) {
+        for (long long slot = (offset + stride - 1) / stride; slot * stride < offset + count; ++slot) set(slot, key(data[slot * stride - offset]));
+    }
+
+    void set(long long slot, const Key& k) {
+        if (slot >= (long long)fences.size()) {
+            fences.resize(slot + 1);
+            present.resize(slot + 1, false);
+        }
+        fences[slot] = k;
+        present[slot] = true;
+    }
+
+    // Posiciones (en registros) de las llaves que faltan para una salida de records registros (por ejemplo, el quicksort
+    // no reescribe una entrada ya ordenada); el que ordena las lee del archivo y las pasa a set
+    std::vector<long long> missing(long long records) {
+        long long slots = (records + stride - 1) / stride;
+        fences.resize(slots);
+        present.resize(slots, false);
+        std::vector<long long> positions;
+        for (long long slot = 0; slot < slots; ++slot) {
+            if (!present[slot]) positions.push_back(slot * stride);
+        }
+        return positions;
+    }
+
+    bool save(const std::string& indexFile, long record_size, long long records) const {
+        FenceIndexHeader header;
+        header.record_size = record_size;
+        header.key_size = sizeof(Key);
+        header.records_per_block = recordsPerBlock;
+        header.blocks_per_fence = blocksPerFence;
+        header.records = records;
+        FILE* file = fopen(indexFile.c_str(), "wb");
+        if (!file) return false;
+        bool ok = fwrite(&header, sizeof(header), 1, file) == 1
+                  && fwrite(fences.data(), sizeof(Key), fences.size(), file) == fences.size();
+        return fclose(file) == 0 && ok;
+    }
+
+private:
+    long recordsPerBlock = 0;
+    long blocksPerFence = 0;
+    long long stride = 0;  // registros entre llaves del índice (0 = sin índice)
+    std::vector<Key> fences;
+    std::vector<bool> present;
+};
+
+
+// Consultas por rango sobre un archivo ordenado con su índice (los mismos KeyFn y Compare con que se ordenó)
+template <typename Record, typename KeyFn, typename Compare>
+class FenceLookup {
+public:
+    using Key = std::decay_t<std::invoke_result_t<KeyFn, const Record&>>;
+
+    long long blockReads = 0;  // bloques leídos del archivo ordenado
+    long long cacheHits = 0;   // bloques servidos desde el cache
+
+    explicit FenceLookup(long cache_blocks = 64, KeyFn key = KeyFn(), Compare comp = Compare())
+        : cacheBlocks(std::max(1L, cache_blocks)), key(key), comp(comp) {}
+    ~FenceLookup() { close(); }
+    FenceLookup(const FenceLookup&) = delete;
+    FenceLookup& operator=(const FenceLookup&) = delete;
+
+    bool open(const std::string& sortedFile) {
+        /* Carga el índice (sortedFile + ".fence") y abre el archivo ordenado
+        args:
+            sortedFile: archivo ordenado
+        returns:
+            false si no hay índice, si es de otro tipo de registro o llave, o si el archivo no existe o cambió de tamaño
+        */
+
+        close();
+        FILE* index = fopen((sortedFile + ".fence").c_str(), "rb");
+        if (!index) return false;
+        FenceIndexHeader expected;
+        bool ok = fread(&header, sizeof(header), 1, index) == 1 && memcmp(header.magic, expected.magic, sizeof(header.magic)) == 0
+                  && header.record_size == (std::int64_t)sizeof(Record) && header.key_size == (std::int64_t)sizeof(Key)
+                  && header.records_per_block > 0 && header.blocks_per_fence > 0;
+        if (ok) {
+            long long stride = header.records_per_block * header.blocks_per_fence;
+            fences.resize((header.records + stride - 1) / stride);
+            ok = fread(fences.data(), sizeof(Key), fences.size(), index) == fences.size();
+        }
+        fclose(index);
+        if (ok) file = fopen(sortedFile.c_str(), "rb");
+        if (file) {
+            fseek(file, 0, SEEK_END);
+            if (ftell(file) != (long)(header.records * header.record_size)) close();
+        }
+        return file != nullptr;
+    }
+
+    void close() {
+        if (file) fclose(file);
+        file = nullptr;
+        cache.clear();
+        lru.clear();
+    }
+
+    long long records() const { return header.records; }
+
+    long long lowerBound(const Key& k) {
+        /* Posición del primer registro con llave >= k (records() si no hay)
+        args:
+            k: llave buscada
+        returns:
+            posición en registros
+        */
+
+        // El primer registro >= k está después de la última llave del índice < k y a lo más en la siguiente
+        long long fence = std::lower_bound(fences.begin(), fences.end(), k, comp) - fences.begin();
+        if (fence == 0) return 0;
+        long long numBlocks = (header.records + header.records_per_block - 1) / header.records_per_block;
+        long long lo = (fence - 1) * header.blocks_per_fence;
+        long long hi = std::min(numBlocks, fence * header.blocks_per_fence);
+        // Último bloque del grupo cuya primera llave es < k (el primero lo es, por el índice)
+        while (hi - lo > 1) {
+            long long middle = lo + (hi - lo) / 2;
+            if (comp(key(block(middle).front()), k)) lo = middle;
+            else hi = middle;
+        }
+        const std::vector<Record>& records = block(lo);
+        long within = std::lower_bound(records.begin(), records.end(), k, [this](const Record& r, const Key& x) { return comp(key(r), x); })
+                      - records.begin();
+        return lo * header.records_per_block + within;
+    }
+
+    std::vector<Record> range(const Key& lo, const Key& hi) {
+        /* Registros con llave en [lo, hi], en orden
+        args:
+            lo, hi: cotas del rango (inclusivas)
+        returns:
+            registros del rango
+        */
+
+        std::vector<Record> result;
+        for (long long position = lowerBound(lo); position < header.records; ) {
+            long long blockIndex = position / header.records_per_block;
+            const std::vector<Record>& records = block(blockIndex);
+            for (size_t i = position - blockIndex * header.records_per_block; i < records.size(); ++i) {
+                if (comp(hi, key(records[i]))) return result;
+                result.push_back(records[i]);
+            }
+            position = (blockIndex + 1) * header.records_per_block;
+        }
+        return result;
+    }
+
+    bool find(const Key& k, Record& record) {
+        /* Primer registro con llave k
+        args:
+            k: llave buscada
+            record: registro encontrado
+        returns:
+            true si hay un registro con llave k
+        */
+
+        long long position = lowerBound(k);
+        if (position >= header.records) return false;
+        const std::vector<Record>& records = block(position / header.records_per_block);
+        const Record& found = records[position % header.records_per_block];
+        if (comp(k, key(found))) return false;
+        record = found;
+        return true;
+    }
+
+private:
+    long cacheBlocks;
+    KeyFn key;
+    Compare comp;
+    FenceIndexHeader header;
+    std::vector<Key> fences;
+    FILE* file = nullptr;
+    // Cache LRU: bloques por número, con el más reciente al frente de lru
+    std::list<long long> lru;
+    std::unordered_map<long long, std::pair<std::list<long long>::iterator, std::vector<Record>>> cache;
+
+    const std::vector<Record>& block(long long index) {
+        auto cached = cache.find(index);
+        if (cached != cache.end()) {
+            cacheHits++;
+            lru.splice(lru.begin(), lru, cached->second.first);
+            return cached->second.second;
+        }
+        if ((long)cache.size() >= cacheBlocks) {
+            cache.erase(lru.back());
+            lru.pop_back();
+        }
+        std::vector<Record> records(std::min<long long>(header.records_per_block, header.records - index * header.records_per_block));
+        fseek(file, (long)(index * header.records_per_block) * (long)sizeof(Record), SEEK_SET);
+        records.resize(fread(records.data(), sizeof(Record), records.size(), file));
+        blockReads++;
+        lru.push_front(index);
+        return cache.emplace(index, std::make_pair(lru.begin(), std::move(records))).first->second.second;
+    }
+};
+
+#endif
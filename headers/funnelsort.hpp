@@ -0,0 +1,11 @@
+// Header para la función de Funnelsort perezoso (cache-oblivious), que se ejecuta en el main.cpp
+#ifndef FUNNELSORT_HPP
+#define FUNNELSORT_HPP
+
+#include <string>
+
+// Ordena inputFile y escribe el resultado en inputFile + ".funnel.sorted" sin usar M ni B; retorna los accesos a disco
+// medidos por el sistema (en bloques de B_SIZE_arg bytes) o -1 si no se pudo ordenar
+long long run_funnelsort(const std::string& inputFile, long N_SIZE, int a, long B_SIZE_arg, long M_SIZE_arg);
+
+#endif
@@ -0,0 +1,427 @@
+// Gobernador de memoria: todos los buffers de los ordenamientos (tramos, bloques de mezcla, particiones, paquetes) se piden
+// a una sola arena de tamaño M, de modo que M deja de ser un número nominal. Por fase registra el máximo de la arena
+// y el pico de memoria residente (RSS) del proceso.
+//
+// Políticas:
+//   UNLIMITED: sin arena, los buffers van al heap y solo se registran los máximos (comportamiento por defecto)
+//   FAIL_FAST: si un pedido excede el presupuesto el programa termina indicando la fase
+//   ADAPT:     los algoritmos ajustan sus pedidos a lo disponible (tramos más cortos, menos tramos por mezcla, lotes más chicos)
+//
+// La arena se mapea con páginas grandes (THP con MADV_HUGEPAGE, o explícitas con MAP_HUGETLB) para reducir los fallos de TLB
+// al ordenar los tramos en memoria; si el sistema no las da, se usan páginas normales. El mapeo solo reserva direcciones
+// (MAP_NORESERVE): las páginas se ocupan al usarse, así que un M grande con una entrada chica no ocupa M de RAM. prefault
+// pre-toca el tramo que se va a usar (antes de medir tiempos) desde el hilo que ordena los tramos: con first-touch las páginas
+// quedan en su nodo NUMA. Por fase se registran además el tiempo y los fallos de dTLB (perf_event_open, si está permitido)
+//
+// Un pedido que cabe en el presupuesto pero no en ningún bloque libre (arena fragmentada) se sirve del heap, se cuenta igual
+// contra M y se reporta aparte: solo exceder el presupuesto es un error. Antes de terminar por exceder el presupuesto se corren
+// las limpiezas registradas con addCleanup (p.ej. borrar los temporales del ordenamiento en curso)
+//
+// Varios trabajos a la vez (ordenamiento por lotes) comparten la arena con una cuenta cada uno (Account): una parte fija
+// del presupuesto, reservada al empezar el trabajo, contra la que se cuentan los pedidos de su hilo y que es lo que ve
+// available() desde ese hilo (lo que un trabajo consulta no lo consume otro), y sus propias fases
+#ifndef MEMORY_GOVERNOR_HPP
+#define MEMORY_GOVERNOR_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+class MemoryGovernor {
+public:
+    enum Policy { UNLIMITED, FAIL_FAST, ADAPT };
+
+    // Páginas de la arena: normales, transparentes (MADV_HUGEPAGE) o explícitas (MAP_HUGETLB, requieren vm.nr_hugepages)
+    enum Pages { NORMAL_PAGES, TRANSPARENT_HUGE_PAGES, EXPLICIT_HUGE_PAGES };
+
+    // Estadísticas de una fase
+    struct PhaseStats {
+        std::string name;
+        size_t arena_high_water;  // bytes de la arena en uso, máximo durante la fase
+        long peak_rss_kb;         // pico de memoria residente del proceso durante la fase (VmHWM)
+        long long time_ms;        // duración de la fase
+        long long dtlb_misses;    // fallos de dTLB en lectura durante la fase (-1 si no se pueden medir)
+    };
+
+    // Cuenta de un trabajo que comparte la arena con otros: su parte del presupuesto y sus fases (el pico de RSS y los fallos
+    // de dTLB son del proceso, así que en sus fases quedan en -1)
+    struct Account {
+        size_t budget = 0;
+        size_t used = 0, highWater = 0, phaseHighWater = 0;
+        std::string phase;
+        std::chrono::steady_clock::time_point phaseStart;
+        std::vector<PhaseStats> phases;
+    };
+
+    static constexpr size_t ALIGNMENT = 64;
+    static constexpr size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+    ~MemoryGovernor() {
+        releaseArena();
+        if (dtlbCounter >= 0) close(dtlbCounter);
+    }
+
+    void configure(size_t budget, Policy newPolicy, Pages requestedPages = TRANSPARENT_HUGE_PAGES) {
+        /* Fija el presupuesto y la política; con FAIL_FAST o ADAPT mapea la arena de tamaño budget con las páginas pedidas
+        (o las que el sistema pueda dar), sin ocupar memoria hasta que se use. Los buffers vivos del heap siguen siendo
+        válidos y se liberan al heap
+        args:
+            budget: tamaño de la arena en bytes (M)
+            newPolicy: política ante pedidos que no caben
+            requestedPages: tipo de páginas de la arena
+        returns:
+            void
+        */
+
+        std::lock_guard<std::mutex> lock(mutex);
+        releaseArena();
+        freeBlocks.clear();
+        policy = newPolicy;
+        if (policy != UNLIMITED && budget > 0) {
+            capacity = roundUp(budget);
+            mapArena(requestedPages);
+            freeBlocks[0] = capacity;
+        }
+        used = highWater = phaseHighWater = 0;
+        fragmentedRequests = fragmentedBytes = 0;
+    }
+
+    void prefault(size_t bytes) {
+        /* Pre-toca los primeros bytes de la arena (a lo más M) desde este hilo: sin esto los fallos de página (y el armado
+        de las páginas grandes) caen dentro de la fase medida. Los buffers se entregan desde el inicio de la arena, así que
+        con bytes = lo que va a usar el ordenamiento (min(M, tamaño de la entrada)) se cubre lo que se pide
+        args:
+            bytes: bytes a pre-tocar
+        returns:
+            void
+        */
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!arena) return;
+        long pageSize = pages == NORMAL_PAGES ? sysconf(_SC_PAGESIZE) : (long)HUGE_PAGE_SIZE;
+        size_t end = std::min(bytes, mappedBytes);
+        for (; touchedBytes < end; touchedBytes += pageSize) arena[touchedBytes] = 0;
+    }
+
+    // Bytes que ocupa en la arena un pedido de bytes (se redondea a ALIGNMENT)
+    static size_t roundUp(size_t bytes) { return (bytes + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT; }
+
+    Pages arenaPages() const { return pages; }
+
+    static const char* pagesName(Pages p) {
+        return p == EXPLICIT_HUGE_PAGES ? "páginas grandes explícitas" : p == TRANSPARENT_HUGE_PAGES ? "páginas grandes (THP)" : "páginas normales";
+    }
+
+    // Asigna al hilo actual la cuenta de su trabajo (nullptr = el presupuesto y las fases del proceso)
+    static void useAccount(Account* account) { threadAccount() = account; }
+
+    Policy currentPolicy() const { return policy; }
+    bool adapts() const { return policy == ADAPT; }
+    size_t budget() const { return capacity; }
+
+    size_t available() {
+        // Mayor bloque contiguo libre de la arena (sin arena, sin límite); con cuenta, lo que le queda de su parte (si ningún
+        // bloque libre alcanza, el pedido se sirve del heap contado contra M, como con la arena fragmentada)
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!arena) return SIZE_MAX;
+        if (Account* account = threadAccount()) return account->budget - std::min(account->budget, account->used);
+        size_t largest = 0;
+        for (const auto& [offset, size] : freeBlocks) largest = std::max(largest, size);
+        return largest;
+    }
+
+    void* allocate(size_t bytes) {
+        /* Entrega bytes de la arena (primer bloque libre que alcanza) o del heap sin arena. Si ningún bloque libre alcanza
+        pero el pedido cabe en el presupuesto, la arena está fragmentada (no se pueden mover los buffers vivos): se sirve
+        del heap y se anota; solo termina el programa si el pedido excede el presupuesto
+        args:
+            bytes: tamaño pedido
+        returns:
+            puntero alineado a ALIGNMENT bytes
+        */
+
+        std::lock_guard<std::mutex> lock(mutex);
+        size_t size = roundUp(std::max<size_t>(bytes, 1));
+        void* pointer = nullptr;
+        Account* account = threadAccount();
+        if (!arena) {
+            pointer = ::operator new(size);
+        } else {
+            if (account && account->used + size > account->budget) exceeded(size, account->used, account->budget, account->phase);
+            for (auto it = freeBlocks.begin(); it != freeBlocks.end(); ++it) {
+                if (it->second >= size) {
+                    size_t offset = it->first, remaining = it->second - size;
+                    freeBlocks.erase(it);
+                    if (remaining > 0) freeBlocks[offset + size] = remaining;
+                    pointer = arena + offset;
+                    break;
+                }
+            }
+            if (!pointer && used + size <= capacity) {
+                pointer = ::operator new(size);
+                fragmentedRequests++;
+                fragmentedBytes += size;
+            }
+            if (!pointer) exceeded(size, used, capacity, phase);
+        }
+        used += size;
+        highWater = std::max(highWater, used);
+        phaseHighWater = std::max(phaseHighWater, used);
+        if (account) {
+            account->used += size;
+            account->highWater = std::max(account->highWater, account->used);
+            account->phaseHighWater = std::max(account->phaseHighWater, account->used);
+        }
+        return pointer;
+    }
+
+    void deallocate(void* pointer, size_t bytes) {
+        std::lock_guard<std::mutex> lock(mutex);
+        size_t size = roundUp(std::max<size_t>(bytes, 1));
+        used -= std::min(used, size);
+        if (Account* account = threadAccount()) account->used -= std::min(account->used, size);
+        char* p = static_cast<char*>(pointer);
+        if (!arena || p < arena || p >= arena + capacity) {
+            ::operator delete(pointer);
+            return;
+        }
+        // Devolver el bloque a la lista libre, uniéndolo con sus vecinos
+        size_t offset = p - arena;
+        auto next = freeBlocks.lower_bound(offset);
+        if (next != freeBlocks.end() && offset + size == next->first) {
+            size += next->second;
+            next = freeBlocks.erase(next);
+        }
+        if (next != freeBlocks.begin()) {
+            auto previous = std::prev(next);
+            if (previous->first + previous->second == offset) {
+                previous->second += size;
+                return;
+            }
+        }
+        freeBlocks[offset] = size;
+    }
+
+    long addCleanup(std::function<void()> cleanup) {
+        // Registra una limpieza para el caso en que el programa termina por exceder el presupuesto (no debe pedir memoria
+        // al gobernador); retorna su id para quitarla con removeCleanup
+        std::lock_guard<std::mutex> lock(mutex);
+        cleanups[nextCleanup] = std::move(cleanup);
+        return nextCleanup++;
+    }
+
+    void removeCleanup(long id) {
+        std::lock_guard<std::mutex> lock(mutex);
+        cleanups.erase(id);
+    }
+
+    void beginPhase(const std::string& name) {
+        /* Empieza una fase (cierra la anterior): reinicia el máximo de la arena y el pico de RSS del proceso (con cuenta, solo
+        el máximo de la cuenta: el pico de RSS es de todos los trabajos)
+        args:
+            name: nombre de la fase en el reporte
+        returns:
+            void
+        */
+
+        endPhase();
+        std::lock_guard<std::mutex> lock(mutex);
+        if (Account* account = threadAccount()) {
+            account->phase = name;
+            account->phaseHighWater = account->used;
+            account->phaseStart = std::chrono::steady_clock::now();
+            return;
+        }
+        phase = name;
+        phaseHighWater = used;
+        // Escribir 5 en clear_refs reinicia VmHWM (Linux); si no se puede, el pico es desde el inicio del proceso
+        std::ofstream clearRefs("/proc/self/clear_refs");
+        if (clearRefs) clearRefs << "5";
+        openDtlbCounter();
+        if (dtlbCounter >= 0) ioctl(dtlbCounter, PERF_EVENT_IOC_RESET, 0);
+        phaseStart = std::chrono::steady_clock::now();
+    }
+
+    void endPhase() {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (Account* account = threadAccount()) {
+            if (account->phase.empty()) return;
+            account->phases.push_back({account->phase, account->phaseHighWater, -1, elapsedMs(account->phaseStart), -1});
+            account->phase.clear();
+            return;
+        }
+        if (phase.empty()) return;
+        long long elapsed = elapsedMs(phaseStart);
+        long long misses = -1;
+        if (dtlbCounter >= 0 && read(dtlbCounter, &misses, sizeof(misses)) != (ssize_t)sizeof(misses)) misses = -1;
+        phases.push_back({phase, phaseHighWater, peakRssKb(), elapsed, misses});
+        phase.clear();
+    }
+
+    const std::vector<PhaseStats>& phaseStats() const { return phases; }
+    size_t arenaHighWater() const { return highWater; }
+
+    void report(std::ostream& out) {
+        /* Imprime por fase el máximo de la arena y el pico de RSS, y borra las fases registradas
+        args:
+            out: stream de salida
+        returns:
+            void
+        */
+
+        endPhase();
+        out << "Memoria (presupuesto " << (capacity ? std::to_string(capacity >> 10) + " KB, " + pagesName(pages) : std::string("sin límite")) << "):" << std::endl;
+        printPhases(out, phases);
+        if (fragmentedRequests > 0) {
+            out << "  pedidos fuera de la arena por fragmentación: " << fragmentedRequests << " (" << (fragmentedBytes >> 10)
+                << " KB, dentro del presupuesto)" << std::endl;
+        }
+        phases.clear();
+        fragmentedRequests = fragmentedBytes = 0;
+    }
+
+    static void printPhases(std::ostream& out, const std::vector<PhaseStats>& stats) {
+        // Una línea por fase (los valores que no se pudieron medir se muestran como n/d)
+        auto measured = [](long long value, const char* unit) { return value >= 0 ? std::to_string(value) + unit : std::string("n/d"); };
+        for (const PhaseStats& phase : stats) {
+            out << "  " << std::left << std::setw(32) << phase.name << std::right << " arena " << std::setw(10) << (phase.arena_high_water >> 10)
+                << " KB, pico RSS " << std::setw(13) << measured(phase.peak_rss_kb, " KB") << ", " << std::setw(8) << phase.time_ms
+                << " ms, fallos dTLB " << measured(phase.dtlb_misses, "") << std::endl;
+        }
+    }
+
+private:
+    Policy policy = UNLIMITED;
+    Pages pages = NORMAL_PAGES;
+    char* arena = nullptr;
+    size_t capacity = 0;
+    size_t mappedBytes = 0;  // tamaño del mapeo (capacity redondeado a páginas grandes)
+    size_t touchedBytes = 0; // inicio de la arena ya pre-tocado por prefault
+    std::map<size_t, size_t> freeBlocks;  // offset -> tamaño de cada bloque libre de la arena
+    size_t used = 0, highWater = 0, phaseHighWater = 0;
+    size_t fragmentedRequests = 0, fragmentedBytes = 0;  // pedidos servidos del heap porque ningún bloque libre alcanzaba
+    std::string phase;
+    std::vector<PhaseStats> phases;
+    std::chrono::steady_clock::time_point phaseStart;
+    std::map<long, std::function<void()>> cleanups;  // limpiezas antes de terminar por exceder el presupuesto
+    long nextCleanup = 0;
+    int dtlbCounter = -1;
+    bool dtlbTried = false;
+    std::mutex mutex;  // los hilos de clasificación del quicksort piden memoria en paralelo
+
+    void mapArena(Pages requested) {
+        /* Mapea la arena con las páginas pedidas, bajando a THP y luego a páginas normales si el sistema no las da. Las
+        páginas normales y THP se mapean sin reservar memoria (MAP_NORESERVE); las explícitas salen del pool de
+        vm.nr_hugepages y sí se reservan (sin reserva, un pool agotado termina el proceso con SIGBUS al tocarlas)
+        args:
+            requested: tipo de páginas pedido
+        returns:
+            void
+        */
+
+        mappedBytes = (capacity + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+        void* pointer = MAP_FAILED;
+        pages = requested;
+        if (pages == EXPLICIT_HUGE_PAGES) {
+            pointer = mmap(nullptr, mappedBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            if (pointer == MAP_FAILED) pages = TRANSPARENT_HUGE_PAGES;  // sin vm.nr_hugepages: THP
+        }
+        if (pointer == MAP_FAILED) {
+            pointer = mmap(nullptr, mappedBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+            if (pointer == MAP_FAILED) {
+                perror("Error while reserving the memory arena");
+                exit(EXIT_FAILURE);
+            }
+            if (pages == TRANSPARENT_HUGE_PAGES && madvise(pointer, mappedBytes, MADV_HUGEPAGE) != 0) pages = NORMAL_PAGES;
+        }
+        arena = static_cast<char*>(pointer);
+    }
+
+    void releaseArena() {
+        if (arena) munmap(arena, mappedBytes);
+        arena = nullptr;
+        capacity = mappedBytes = touchedBytes = 0;
+    }
+
+    void openDtlbCounter() {
+        // Contador de fallos de dTLB en lectura del proceso (y de los hilos que cree); se intenta una sola vez
+        if (dtlbTried) return;
+        dtlbTried = true;
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HW_CACHE;
+        attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.inherit = 1;
+        dtlbCounter = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+
+    static Account*& threadAccount() {
+        thread_local Account* account = nullptr;
+        return account;
+    }
+
+    static long long elapsedMs(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    [[noreturn]] void exceeded(size_t size, size_t inUse, size_t limit, const std::string& phaseName) {
+        // Pedido que excede el presupuesto (del proceso o de la cuenta del trabajo): limpia y termina
+        std::cerr << "Presupuesto de memoria excedido" << (phaseName.empty() ? "" : " en la fase '" + phaseName + "'")
+                  << ": se pidieron " << size << " bytes, en uso " << inUse << " de " << limit << " bytes" << std::endl;
+        for (const auto& [id, cleanup] : cleanups) cleanup();
+        exit(EXIT_FAILURE);
+    }
+
+    static long peakRssKb() {
+        std::ifstream status("/proc/self/status");
+        std::string line;
+        while (std::getline(status, line)) {
+            if (line.rfind("VmHWM:", 0) == 0) return std::atol(line.c_str() + 6);
+        }
+        return -1;
+    }
+};
+
+// Gobernador global (igual que los demás parámetros globales de los algoritmos)
+inline MemoryGovernor memory_governor;
+
+// Allocator de los buffers de los ordenamientos: pide la memoria al gobernador
+template <typename T>
+struct ArenaAllocator {
+    using value_type = T;
+
+    ArenaAllocator() = default;
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>&) {}
+
+    T* allocate(size_t n) { return static_cast<T*>(memory_governor.allocate(n * sizeof(T))); }
+    void deallocate(T* pointer, size_t n) { memory_governor.deallocate(pointer, n * sizeof(T)); }
+
+    template <typename U>
+    bool operator==(const ArenaAllocator<U>&) const { return true; }
+    template <typename U>
+    bool operator!=(const ArenaAllocator<U>&) const { return false; }
+};
+
+template <typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+#endif
@@ -2,8 +2,38 @@
 #define MERGESORT_HPP
 
 #include <string>
+#include <vector>
 
 // Interface function to run external merge sort
-int run_mergesort(const std::string& inputFile, long N_SIZE, int a, long B_SIZE_arg, long M_SIZE_arg);
+long long run_mergesort(const std::string& inputFile, long N_SIZE, int a, long B_SIZE_arg, long M_SIZE_arg);
+
+// Mergesort con checkpoints: escribe inputFile + ".sorted" llevando un manifiesto (inputFile + ".sorted.manifest");
+// si ya existe uno de la misma entrada y parámetros, retoma desde el último trabajo completo
+long long run_mergesort_checkpointed(const std::string& inputFile, int a, long B_SIZE_arg, long M_SIZE_arg);
+
+// Retoma el mergesort interrumpido de inputFile con los parámetros de su manifiesto; retorna -1 si no hay manifiesto
+long long resume_mergesort(const std::string& inputFile);
+
+// Mergesort con la salida en num_shards shards por rango de llave (inputFile + ".sorted.shard<i>") y su índice
+// (inputFile + ".sorted.shards")
+long long run_mergesort_sharded(const std::string& inputFile, int a, long B_SIZE_arg, long M_SIZE_arg, int num_shards);
+
+// Mergesort que además escribe el índice disperso de la salida (inputFile + ".sorted.fence", una llave cada blocks_per_fence bloques)
+long long run_mergesort_fenced(const std::string& inputFile, int a, long B_SIZE_arg, long M_SIZE_arg, long blocks_per_fence);
+
+// Enteros con valor en [lo, hi] de un archivo ordenado con índice disperso, en result; retorna los bloques leídos o -1 si no
+// hay índice
+long long run_range_query(const std::string& sortedFile, long long lo, long long hi, std::vector<long long>& result);
+
+// Mezcla archivos de enteros de 64 bits ya ordenados en outputFile, sin formar tramos (termina con error si uno no está ordenado)
+long long run_merge_sorted(const std::vector<std::string>& inputFiles, const std::string& outputFile, int a, long B_SIZE_arg, long M_SIZE_arg);
+
+// Agrega un lote de enteros de 64 bits al almacén por niveles de base (tiered_store.hpp): ordena solo el lote y compacta los
+// niveles llenos (tier_ratio archivos por nivel, solo al crear el almacén; 0 = el anotado o 4); si base es un archivo
+// ordenado sin almacén, lo adopta. Retorna los accesos
+long long run_append_batch(const std::string& base, const std::string& batchFile, int a, long B_SIZE_arg, long M_SIZE_arg, int tier_ratio);
+
+// Compactación completa del almacén de base: deja un único archivo ordenado; retorna los accesos a disco
+long long run_compact_store(const std::string& base, int a, long B_SIZE_arg, long M_SIZE_arg);
 
 #endif
\ No newline at end of file
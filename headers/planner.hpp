@@ -0,0 +1,81 @@
+// Header del planificador automático: a partir de una medición corta del dispositivo y de un modelo de costo de E/S y CPU,
+// elige algoritmo (mergesort o quicksort), aridad a y tamaño de bloque B para un (N, M) dado
+#ifndef PLANNER_HPP
+#define PLANNER_HPP
+
+#include <string>
+#include <vector>
+
+// Medición del dispositivo donde quedan los archivos (y del costo de comparar en memoria)
+struct DeviceCalibration {
+    double seq_read_mb_s;       // ancho de banda de lectura secuencial (MB/s)
+    double seq_write_mb_s;      // ancho de banda de escritura secuencial (MB/s)
+    double access_latency_ms;   // latencia de un acceso a un bloque en una posición aleatoria (ms)
+    double cpu_ns_per_compare;  // costo de una comparación al ordenar en memoria (ns)
+};
+
+// Medición de un tamaño de bloque y una profundidad de cola (lecturas aleatorias concurrentes) en el dispositivo
+struct BlockMeasurement {
+    long block_size;
+    int queue_depth;
+    double seq_read_mb_s;
+    double seq_write_mb_s;
+    double rand_read_mb_s;
+    double rand_latency_ms;     // latencia media de una lectura aleatoria
+};
+
+// Perfil del dispositivo (./main calibrate): barrido de bloques de 4 KB a 16 MB y de profundidades de cola,
+// con el tamaño de bloque y la profundidad recomendados
+struct DeviceProfile {
+    long recommended_block_size;
+    int recommended_queue_depth;
+    std::vector<BlockMeasurement> measurements;
+};
+
+// Nombre del perfil dentro del directorio de archivos temporales
+const std::string DEVICE_PROFILE_FILE = "device_profile.txt";
+
+// Plan elegido y su predicción
+struct SortPlan {
+    enum Algorithm { MERGESORT, QUICKSORT };
+    Algorithm algorithm;
+    int a;                            // aridad de la mezcla / particiones del quicksort
+    long B_SIZE;                      // tamaño del bloque (y de cada buffer de lectura/escritura) en bytes
+    long M_SIZE;                      // memoria principal en bytes
+    long buffer_bytes;                // parte de M para los buffers de bloque de la mezcla o distribución: (a + 1) * B
+    long long predicted_disk_access;
+    double predicted_time_ms;
+};
+
+// Resultado medido al ejecutar un plan
+struct PlanResult {
+    long long time_ms;
+    long long disk_access;
+};
+
+// Mide el dispositivo con un archivo temporal en directory (algunos MB, unos segundos); si directory tiene un perfil
+// guardado se usan sus mediciones de E/S y solo se mide el costo de comparación
+DeviceCalibration calibrate_device(const std::string& directory);
+
+// Barrido completo del dispositivo con un archivo temporal de file_bytes en directory
+DeviceProfile probe_device(const std::string& directory, long file_bytes);
+bool save_device_profile(const DeviceProfile& profile, const std::string& directory);
+bool load_device_profile(const std::string& directory, DeviceProfile& profile);
+
+// Tamaño de bloque recomendado por el perfil de directory, ajustado para que quepan a + 1 buffers en M (4096 si no hay perfil);
+// los run_* lo usan con B_SIZE_arg = 0
+long profile_block_size(long M_SIZE, int a, const std::string& directory = ".");
+
+// Costo predicho de un algoritmo con (a, B) dados; guarda en disk_access los accesos a disco estimados
+double predict_time_ms(SortPlan::Algorithm algorithm, long long N_BYTES, long M_SIZE, int a, long B_SIZE,
+                       const DeviceCalibration& device, long long& disk_access);
+
+// Recorre los candidatos (algoritmo, a, B) con (a + 1) * B <= M y retorna el de menor tiempo predicho
+SortPlan plan_sort(long long N_BYTES, long M_SIZE, const DeviceCalibration& device);
+
+// Ejecuta el plan sobre inputFile (mergesort escribe inputFile + ".sorted", quicksort ordena en el lugar)
+PlanResult run_plan(const std::string& inputFile, long long N_BYTES, const SortPlan& plan);
+
+const char* algorithm_name(SortPlan::Algorithm algorithm);
+
+#endif
@@ -4,6 +4,44 @@
 
 #include <string>
 
+// Opciones del Quicksort Externo (se fijan antes de llamar a run_quicksort)
+struct QuicksortOptions {
+    // Modo híbrido: las particiones que caben en M no se recursan, se empaquetan
+    // junto a sus hermanas contiguas en una sola carga de tamaño M y se escriben ordenadas directo a la salida
+    bool absorb_small_partitions = true;
+    // Modo de muchos duplicados: los elementos iguales a un pivote van a un bucket de igualdad
+    // que se escribe una sola vez y nunca se recursa (si es false, solo se activa al detectar una partición sin progreso)
+    bool equality_buckets = true;
+    // Tramos naturales: antes de particionar se recorre la entrada hasta la primera inversión; si ya está ordenada termina
+    // ahí (una pasada de lectura) y si está en orden descendente solo se invierte en el lugar
+    bool detect_presorted = true;
+
+    // Orden en que la cola de tareas procesa las particiones pendientes
+    enum QueueOrder { DEPTH_FIRST, LARGEST_FIRST };
+    QueueOrder queue_order = DEPTH_FIRST;
+    // Máximo de descriptores de particiones abiertos a la vez al distribuir (si se supera, se abre y cierra en cada volcado)
+    int max_open_files = 64;
+    // Máximo de archivos temporales vivos: al superarlo la cola procesa primero las tareas más pequeñas
+    long max_live_temp_files = 1024;
+    // Máximo de tareas en memoria: las demás se vuelcan a un archivo de tareas
+    long max_tasks_in_memory = 4096;
+
+    // Hilos que clasifican en paralelo franjas disjuntas de cada lote leído (1 = sin hilos)
+    int classification_threads = 1;
+    // Bloques de tamaño B que clasifica cada hilo por lote
+    long blocks_per_stripe = 64;
+};
+
+// Opciones con las que se crean los contextos nuevos (SortContext) y las que usa run_quicksort sin contexto
+void set_quicksort_options(const QuicksortOptions& options);
+QuicksortOptions default_quicksort_options();
+
+struct SortContext;
+
+// Ordena inputFile en el lugar con la configuración, el contador y los temporales del contexto; retorna los accesos a disco
+long long run_quicksort(SortContext& context, const std::string& inputFile, long N_SIZE);
+
+// Igual, con un contexto nuevo de tamaño de bloque B_SIZE_arg (0 = el del perfil del dispositivo), memoria M_SIZE_arg y aridad a
 long long run_quicksort(const std::string& inputFile, long N_SIZE, int a, long B_SIZE_arg, long M_SIZE_arg);
 
-#endif
\ No newline at end of file
+#endif
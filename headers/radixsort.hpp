@@ -0,0 +1,10 @@
+// Header para la función de Radix Sort Externo (MSD), que se ejecuta en el main.cpp
+#ifndef RADIXSORT_HPP
+#define RADIXSORT_HPP
+
+#include <string>
+
+// Ordena inputFile y escribe el resultado en inputFile + ".radix.sorted"; retorna los accesos a disco
+long long run_radixsort(const std::string& inputFile, long N_SIZE, int a, long B_SIZE_arg, long M_SIZE_arg);
+
+#endif
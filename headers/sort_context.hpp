@@ -0,0 +1,79 @@
+// Contexto de un ordenamiento: configuración (B, M, a y opciones del quicksort), contador de accesos a disco, generador
+// aleatorio de los pivotes y espacio de nombres de los archivos temporales. Cada ordenamiento tiene el suyo y se pasa a
+// todas sus funciones, así que en un mismo proceso se pueden ordenar varios archivos a la vez (un contexto por hilo).
+// La memoria sigue saliendo del gobernador del proceso (memory_governor.hpp), que es el presupuesto compartido
+#ifndef SORT_CONTEXT_HPP
+#define SORT_CONTEXT_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include "quicksort.hpp"
+
+// Tamaños en bytes, registros y offsets son long (y los contadores long long): con M de varios GB y archivos de cientos
+// de GB hacen falta 64 bits, como en Linux de 64 bits (LP64)
+static_assert(sizeof(long) == 8, "los tamaños, offsets y fseek de los ordenamientos requieren long de 64 bits (LP64)");
+
+struct SortContext {
+    long B_SIZE;                         // tamaño del bloque en bytes
+    long M_SIZE;                         // tamaño de la memoria principal en bytes
+    int a;                               // aridad del mergesort / particiones del quicksort / buckets del radix
+    QuicksortOptions quicksort_options;  // opciones del quicksort (las fijadas con set_quicksort_options al crear el contexto)
+    long long disk_access = 0;           // accesos a disco del ordenamiento
+    std::mt19937_64 rng;                 // generador de los pivotes y bloques aleatorios
+    std::string temp_prefix;             // prefijo de los temporales: directorio + "sort<pid>_<n>_"
+    // Aviso de cambio de fase para el planificador de lotes (batch_sort.hpp): false = formación de tramos (CPU),
+    // true = mezcla (E/S); puede bloquear hasta que haya ancho de banda para la fase
+    std::function<void(bool io_bound)> on_phase;
+    // Aviso entre dos pasadas de la mezcla con las pasadas que faltan, para que el planificador de lotes vuelva a ordenar
+    // los turnos de mezcla según el trabajo que le queda a cada uno
+    std::function<void(int passes_left)> on_merge_pass;
+    // Aviso de cada escritura en la salida final (count registros de data desde la posición offset), para armar el índice
+    // disperso de la salida en la misma pasada (fence_index.hpp)
+    std::function<void(long long offset, const void* data, long count)> on_output_write;
+
+    SortContext(long B_SIZE, long M_SIZE, int a, const std::string& temp_directory = ".")
+        : B_SIZE(B_SIZE), M_SIZE(M_SIZE), a(a), quicksort_options(default_quicksort_options()) {
+        static std::atomic<long> next_id{0};
+        long id = next_id++;
+        rng.seed(std::random_device{}() ^ (std::uint64_t)id);
+        temp_prefix = temp_directory + "/sort" + std::to_string(getpid()) + "_" + std::to_string(id) + "_";
+    }
+
+    // Nombre de un archivo temporal del ordenamiento (no choca con los de otro contexto)
+    std::string tempName(const std::string& name) const { return temp_prefix + name; }
+
+    void removeTemporaries() const {
+        // Borra los temporales que queden de este contexto (los archivos del directorio temporal con su prefijo)
+        std::filesystem::path prefix(temp_prefix);
+        std::string name = prefix.filename().string();
+        std::error_code error;
+        std::vector<std::filesystem::path> found;
+        for (const auto& entry : std::filesystem::directory_iterator(prefix.parent_path(), error)) {
+            if (entry.path().filename().string().rfind(name, 0) == 0) found.push_back(entry.path());
+        }
+        for (const std::filesystem::path& path : found) std::filesystem::remove(path, error);
+    }
+
+    void enterPhase(bool io_bound) {
+        if (on_phase) on_phase(io_bound);
+    }
+
+    void mergePass(int passes_left) {
+        if (on_merge_pass) on_merge_pass(passes_left);
+    }
+
+    void outputWritten(long long offset, const void* data, long count) {
+        if (on_output_write) on_output_write(offset, data, count);
+    }
+
+    // Entero aleatorio uniforme en [0, n)
+    long random(long n) { return std::uniform_int_distribution<long>(0, n - 1)(rng); }
+};
+
+#endif
@@ -0,0 +1,195 @@
+// Manifiesto de un ordenamiento externo con checkpoints: archivo de texto (salida + ".manifest") donde se agrega una línea
+// por cada trabajo terminado y ya escrito en disco (cada porción de un tramo inicial, el fin de la fase de tramos, la aridad
+// de la mezcla y cada tramo mezclado), con el número de registros y un checksum del archivo. Si el proceso muere, al volver
+// a ejecutarse se verifican los archivos contra el manifiesto y se sigue desde el último trabajo completo
+//
+// Formato (una entrada por línea):
+//   input <archivo> <bytes> record <bytes> B <B_SIZE> M <M_SIZE> a <a> op <operador>
+//   run <tramo> <registros de entrada consumidos> <registros del tramo> <checksum>   (la última línea de un tramo manda)
+//   runs <número de tramos>                                                          (fase de tramos completa)
+//   fan_in <tramos por mezcla>
+//   merged <tramo> <registros> <checksum>                                            (tramo intermedio de una pasada)
+#ifndef SORT_MANIFEST_HPP
+#define SORT_MANIFEST_HPP
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+
+class SortManifest {
+public:
+    // Parámetros del ordenamiento: un manifiesto solo se retoma si coinciden
+    struct Header {
+        std::string input;
+        long long input_bytes = 0;
+        long record_size = 0;
+        long B_SIZE = 0;
+        long M_SIZE = 0;
+        int a = 0;
+        int op = 0;
+
+        bool operator==(const Header& other) const {
+            return input == other.input && input_bytes == other.input_bytes && record_size == other.record_size
+                && B_SIZE == other.B_SIZE && M_SIZE == other.M_SIZE && a == other.a && op == other.op;
+        }
+    };
+
+    // Un tramo escrito: registros que contiene y checksum de sus bytes
+    struct RunEntry {
+        long long input_end = 0;  // registros de la entrada consumidos al terminar de escribirlo (solo tramos iniciales)
+        long long records = 0;
+        std::uint64_t checksum = CHECKSUM_SEED;
+    };
+
+    // FNV-1a de 64 bits: se puede continuar sobre datos agregados al final (tramos naturales que se extienden)
+    static constexpr std::uint64_t CHECKSUM_SEED = 1469598103934665603ULL;
+    static std::uint64_t checksum(std::uint64_t hash, const void* data, size_t bytes) {
+        const unsigned char* p = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < bytes; ++i) hash = (hash ^ p[i]) * 1099511628211ULL;
+        return hash;
+    }
+
+    Header header;
+    std::map<int, RunEntry> runs;     // tramos iniciales (la última línea de cada uno)
+    int completedRuns = -1;           // número de tramos si la fase de tramos terminó, -1 si no
+    int fanIn = 0;                    // tramos por mezcla fijados al empezar la fase de mezcla (0 si no empezó)
+    std::map<int, RunEntry> merged;   // tramos intermedios de la mezcla
+
+    static bool readHeader(const std::string& path, Header& header) {
+        /* Lee solo los parámetros de un manifiesto (para retomar sin conocerlos)
+        args:
+            path: ruta del manifiesto
+            header: parámetros leídos
+        returns:
+            true si el manifiesto existe y tiene encabezado
+        */
+
+        std::ifstream file(path);
+        std::string line;
+        return std::getline(file, line) && parseHeader(line, header);
+    }
+
+    bool load(const std::string& path) {
+        /* Lee un manifiesto; una última línea incompleta (el proceso murió mientras se escribía) se ignora
+        args:
+            path: ruta del manifiesto
+        returns:
+            true si el manifiesto existe y tiene encabezado
+        */
+
+        std::ifstream file(path);
+        std::string line;
+        if (!std::getline(file, line) || !parseHeader(line, header)) return false;
+        while (std::getline(file, line)) {
+            if (file.eof()) break;  // sin salto de línea final: la línea quedó a medio escribir
+            std::istringstream entry(line);
+            std::string kind;
+            entry >> kind;
+            if (kind == "run") {
+                int run;
+                RunEntry value;
+                if (entry >> run >> value.input_end >> value.records >> value.checksum) runs[run] = value;
+            } else if (kind == "runs") {
+                entry >> completedRuns;
+            } else if (kind == "fan_in") {
+                entry >> fanIn;
+            } else if (kind == "merged") {
+                int run;
+                RunEntry value;
+                if (entry >> run >> value.records >> value.checksum) merged[run] = value;
+            }
+        }
+        return true;
+    }
+
+    void create(const std::string& path, const Header& newHeader) {
+        // Empieza un manifiesto nuevo (descarta uno anterior)
+        close();
+        header = newHeader;
+        runs.clear();
+        merged.clear();
+        completedRuns = -1;
+        fanIn = 0;
+        filePath = path;
+        file = fopen(path.c_str(), "w");
+        if (!file) {
+            perror("Error while creating the sort manifest");
+            exit(EXIT_FAILURE);
+        }
+        append("input " + header.input + " " + std::to_string(header.input_bytes) + " record " + std::to_string(header.record_size)
+               + " B " + std::to_string(header.B_SIZE) + " M " + std::to_string(header.M_SIZE) + " a " + std::to_string(header.a)
+               + " op " + std::to_string(header.op));
+    }
+
+    void reopen(const std::string& path) {
+        // Sigue agregando líneas a un manifiesto cargado con load
+        close();
+        filePath = path;
+        file = fopen(path.c_str(), "a");
+        if (!file) {
+            perror("Error while opening the sort manifest");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    void append(const std::string& line) {
+        // Agrega una línea y la deja en disco antes de seguir (el trabajo que describe ya está en disco)
+        fprintf(file, "%s\n", line.c_str());
+        fflush(file);
+        fsync(fileno(file));
+    }
+
+    void recordRun(int run, const RunEntry& entry) {
+        runs[run] = entry;
+        append("run " + std::to_string(run) + " " + std::to_string(entry.input_end) + " " + std::to_string(entry.records) + " " + std::to_string(entry.checksum));
+    }
+
+    void recordRuns(int num_runs) {
+        completedRuns = num_runs;
+        append("runs " + std::to_string(num_runs));
+    }
+
+    void recordFanIn(int fan_in) {
+        fanIn = fan_in;
+        append("fan_in " + std::to_string(fan_in));
+    }
+
+    void recordMerged(int run, const RunEntry& entry) {
+        merged[run] = entry;
+        append("merged " + std::to_string(run) + " " + std::to_string(entry.records) + " " + std::to_string(entry.checksum));
+    }
+
+    void close() {
+        if (file) fclose(file);
+        file = nullptr;
+    }
+
+    void finish() {
+        // La salida quedó completa: el manifiesto se borra antes que los tramos (si el proceso muere entremedio solo quedan
+        // tramos sueltos, no un manifiesto que apunte a tramos borrados)
+        close();
+        if (!filePath.empty()) remove(filePath.c_str());
+        filePath.clear();
+    }
+
+    ~SortManifest() { close(); }
+
+private:
+    FILE* file = nullptr;
+    std::string filePath;
+
+    static bool parseHeader(const std::string& line, Header& header) {
+        std::istringstream entry(line);
+        std::string kind, recordTag, bTag, mTag, aTag, opTag;
+        return entry >> kind >> header.input >> header.input_bytes >> recordTag >> header.record_size >> bTag >> header.B_SIZE
+                     >> mTag >> header.M_SIZE >> aTag >> header.a >> opTag >> header.op
+            && kind == "input";
+    }
+};
+
+#endif
@@ -0,0 +1,436 @@
+// Almacén ordenado por niveles (estilo LSM) para datos que llegan por lotes (por ejemplo, logs cada hora): en vez de volver
+// a ordenar todo con cada lote, el lote nuevo se ordena solo (mergesort externo) y queda como un archivo ordenado más.
+// Los archivos se agrupan en niveles por tamaño; cuando un nivel junta tier_ratio archivos, se mezclan en uno solo del nivel
+// siguiente (una mezcla de tier_ratio vías). Así cada registro se reescribe una vez por nivel, O(log_ratio(N / M)) veces en
+// total, en lugar de una vez por lote. Cada mezcla junta a lo más a archivos (o los que quepan en la arena si el gobernador
+// adapta), por pasadas como la fase de mezcla del mergesort. compact() mezcla todo en un único archivo, que queda de nuevo en base (con su índice
+// en base + ".fence"), como si se hubiera ordenado de una vez.
+//
+// Las lecturas mezclan los niveles: forEach recorre todos los registros en orden y range busca en cada archivo con su índice
+// disperso (fence_index.hpp, un bloque por llave) y mezcla los resultados.
+//
+// Estado en base + ".tiers" (texto, se reemplaza completo al cambiar): los archivos nuevos se escriben completos antes de
+// anotarse, y los mezclados se borran recién después de anotar el resultado, así que un corte deja el almacén consistente.
+// El ratio y la memoria con que se calculan los niveles quedan fijos al crear el almacén (si cambiaran, los archivos ya
+// anotados quedarían en niveles que no les corresponden)
+//   ratio <archivos por nivel>
+//   memory <bytes de memoria del nivel 0>
+//   next <siguiente número de archivo>
+//   file <nivel> <registros> <archivo>
+#ifndef TIERED_STORE_HPP
+#define TIERED_STORE_HPP
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <queue>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "external_sorter.hpp"
+#include "fence_index.hpp"
+#include "memory_governor.hpp"
+
+template <typename Record, typename KeyFn = IdentityKey<Record>, typename Compare = std::less<>>
+class TieredStore {
+public:
+    using Sorter = ExternalSorter<Record, KeyFn, Compare>;
+    using Key = typename Sorter::Key;
+
+    struct Tier {
+        int level;
+        long long records;
+        std::string file;
+    };
+
+    long long countIO = 0;  // accesos a disco de la última operación (append, compact, range o forEach)
+
+    // Carga el almacén de base; si no tiene estado pero base existe (un archivo ya ordenado), lo adopta como su primer archivo
+    // (desde ahí es del almacén: una compactación por niveles lo mezcla en otro archivo, y compact() lo vuelve a dejar en base).
+    // tier_ratio y M_SIZE fijan los niveles solo de un almacén nuevo; uno existente sigue con los de su estado
+    // (tier_ratio = 0: el anotado, o DEFAULT_TIER_RATIO si el almacén es nuevo)
+    TieredStore(const std::string& base, long B_SIZE, long M_SIZE, int a, int tier_ratio = 0, KeyFn key = KeyFn(), Compare comp = Compare())
+        : base(base), B_SIZE(B_SIZE), M_SIZE(M_SIZE), a(std::max(2, a)),
+          tierRatio(std::clamp(tier_ratio > 0 ? tier_ratio : DEFAULT_TIER_RATIO, 2, std::max(2, a))), levelMemory(M_SIZE),
+          key(key), comp(comp), recordsPerBlock(std::max(1L, B_SIZE / (long)sizeof(Record))) {
+        if (load()) {
+            if (tier_ratio > 0 && tier_ratio != tierRatio) {
+                std::cerr << "Warning: " << base << " was created with tier ratio " << tierRatio << ", ignoring " << tier_ratio << std::endl;
+            }
+        } else if (std::filesystem::exists(base)) {
+            adopt();
+        }
+        // Un corte entre el renombre del resultado de compact() a base y el guardado del estado deja anotado un archivo que
+        // ya no existe: se termina el renombre
+        if (tierFiles.size() == 1 && tierFiles[0].file != base && !std::filesystem::exists(tierFiles[0].file)
+            && std::filesystem::exists(base)) {
+            moveToBase();
+        }
+    }
+
+    const std::vector<Tier>& tiers() const { return tierFiles; }
+
+    long long records() const {
+        long long total = 0;
+        for (const Tier& tier : tierFiles) total += tier.records;
+        return total;
+    }
+
+    long long append(const std::string& batchFile) {
+        /* Agrega un lote: lo ordena en un archivo nuevo de su nivel y compacta los niveles que quedan llenos
+        args:
+            batchFile: archivo con los registros nuevos (sin ordenar; no se modifica)
+        returns:
+            countIO: accesos a disco (orden del lote + compactaciones)
+        */
+
+        countIO = 0;
+        std::string file = nextFile();
+        Sorter sorter(B_SIZE, M_SIZE, a, key, comp);
+        sorter.setFenceIndex(1);
+        countIO += sorter.mergesort(batchFile, file);
+        long long batchRecords = fileRecords(file);
+        tierFiles.push_back({levelOf(batchRecords), batchRecords, file});
+        save();
+        compactFullLevels();
+        return countIO;
+    }
+
+    long long compact() {
+        /* Compactación completa: mezcla todos los archivos en uno solo y lo deja en base
+        returns:
+            countIO: accesos a disco
+        */
+
+        countIO = 0;
+        mergeAll(tierFiles, levelOf(records()));
+        if (tierFiles.size() == 1 && tierFiles[0].file != base) {
+            // Si base sigue existiendo no es del almacén (se creó después de empezar): no se pisa
+            if (std::filesystem::exists(base)) {
+                std::cerr << "Warning: " << base << " is not part of the store, the compacted data stays in " << tierFiles[0].file << std::endl;
+            } else {
+                moveToBase();
+            }
+        }
+        return countIO;
+    }
+
+    template <typename Fn>
+    void forEach(Fn fn) {
+        /* Recorre todos los registros del almacén en orden, mezclando los niveles (un bloque en memoria por archivo)
+        args:
+            fn: función que recibe cada registro
+        returns:
+            void
+        */
+
+        countIO = 0;
+        std::vector<std::string> files;
+        for (const Tier& tier : tierFiles) files.push_back(tier.file);
+        mergeFiles(files, fn);
+    }
+
+    std::vector<Record> range(const Key& lo, const Key& hi) {
+        /* Registros con llave en [lo, hi] de todos los niveles, en orden
+        args:
+            lo, hi: cotas del rango (inclusivas)
+        returns:
+            registros del rango
+        */
+
+        countIO = 0;
+        if (lookups.size() != tierFiles.size()) {
+            lookups.clear();
+            for (const Tier& tier : tierFiles) {
+                lookups.push_back(std::make_unique<Lookup>(16, key, comp));
+                if (!lookups.back()->open(tier.file)) {
+                    std::cerr << "Error: " << tier.file << " has no valid fence index" << std::endl;
+                    exit(EXIT_FAILURE);
+                }
+            }
+        }
+        std::vector<Record> result;
+        for (std::unique_ptr<Lookup>& lookup : lookups) {
+            long long before = lookup->blockReads;
+            std::vector<Record> found = lookup->range(lo, hi);
+            countIO += lookup->blockReads - before;
+            size_t middle = result.size();
+            result.insert(result.end(), found.begin(), found.end());
+            std::inplace_merge(result.begin(), result.begin() + middle, result.end(),
+                               [this](const Record& x, const Record& y) { return comp(key(x), key(y)); });
+        }
+        return result;
+    }
+
+private:
+    using Lookup = FenceLookup<Record, KeyFn, Compare>;
+
+    std::string base;
+    long B_SIZE;
+    long M_SIZE;
+    int a;
+    static constexpr int DEFAULT_TIER_RATIO = 4;
+    int tierRatio;            // archivos por nivel antes de mezclarlos en el siguiente (anotado en el estado)
+    long levelMemory;         // memoria (bytes) con que se calcula la capacidad del nivel 0 (anotada en el estado)
+    KeyFn key;
+    Compare comp;
+    long recordsPerBlock;
+    std::vector<Tier> tierFiles;
+    long nextId = 0;
+    std::vector<std::unique_ptr<Lookup>> lookups;  // índices abiertos de los archivos (se rehacen al cambiar los niveles)
+
+    std::string stateFile() const { return base + ".tiers"; }
+    std::string nextFile() { return base + ".tier" + std::to_string(nextId++); }
+
+    static long long fileRecords(const std::string& file) {
+        std::error_code error;
+        return (long long)std::filesystem::file_size(file, error) / (long long)sizeof(Record);
+    }
+
+    // Nivel de un archivo según su tamaño: el nivel 0 llega hasta ratio * M registros y cada nivel es ratio veces el anterior
+    int levelOf(long long records) const {
+        int level = 0;
+        long long recordsInMemory = std::max(1L, levelMemory / (long)sizeof(Record));
+        for (long long capacity = recordsInMemory * tierRatio; records > capacity; capacity *= tierRatio) level++;
+        return level;
+    }
+
+    bool load() {
+        std::ifstream state(stateFile());
+        if (!state) return false;
+        std::string line, word;
+        while (std::getline(state, line)) {
+            std::istringstream fields(line);
+            fields >> word;
+            if (word == "ratio") {
+                fields >> tierRatio;
+            } else if (word == "memory") {
+                fields >> levelMemory;
+            } else if (word == "next") {
+                fields >> nextId;
+            } else if (word == "file") {
+                Tier tier;
+                fields >> tier.level >> tier.records;
+                std::getline(fields >> std::ws, tier.file);
+                tierFiles.push_back(tier);
+            }
+        }
+        return true;
+    }
+
+    void save() {
+        // Se escribe completo a un lado y se renombra: el estado anterior sigue valiendo hasta el rename
+        std::string temporary = stateFile() + ".tmp";
+        {
+            std::ofstream state(temporary);
+            state << "ratio " << tierRatio << "\n";
+            state << "memory " << levelMemory << "\n";
+            state << "next " << nextId << "\n";
+            for (const Tier& tier : tierFiles) state << "file " << tier.level << " " << tier.records << " " << tier.file << "\n";
+            state.flush();
+            if (!state) {
+                std::cerr << "Error while writing " << temporary << std::endl;
+                exit(EXIT_FAILURE);
+            }
+        }
+        std::filesystem::rename(temporary, stateFile());
+        lookups.clear();
+    }
+
+    void adopt() {
+        // El archivo ordenado que ya existía es el primer archivo del almacén; se le arma el índice disperso leyendo la
+        // primera llave de cada bloque
+        long long total = fileRecords(base);
+        FenceIndexBuilder<Key> fence(recordsPerBlock, 1);
+        FILE* file = fopen(base.c_str(), "rb");
+        Record record;
+        for (long long position : fence.missing(total)) {
+            fseek(file, (long)position * (long)sizeof(Record), SEEK_SET);
+            if (fread(&record, sizeof(Record), 1, file) == 1) fence.add(position, &record, 1, key);
+            countIO++;
+        }
+        fclose(file);
+        fence.save(base + ".fence", sizeof(Record), total);
+        tierFiles.push_back({levelOf(total), total, base});
+        save();
+    }
+
+    void moveToBase() {
+        // Renombra el único archivo del almacén (y su índice) a base y lo anota; si se cortó a medias, termina lo que falte
+        Tier& tier = tierFiles[0];
+        if (std::filesystem::exists(tier.file)) std::filesystem::rename(tier.file, base);
+        if (std::filesystem::exists(tier.file + ".fence")) std::filesystem::rename(tier.file + ".fence", base + ".fence");
+        tier.file = base;
+        save();
+    }
+
+    // Política de compactación: del nivel 0 hacia arriba, un nivel con tierRatio archivos se mezcla en uno del nivel siguiente
+    // (o más arriba si el resultado es más grande); la mezcla puede llenar el siguiente nivel, que se revisa a continuación
+    void compactFullLevels() {
+        for (int level = 0; ; ++level) {
+            std::vector<Tier> inputs;
+            int highest = 0;
+            for (const Tier& tier : tierFiles) {
+                if (tier.level == level) inputs.push_back(tier);
+                highest = std::max(highest, tier.level);
+            }
+            if (level > highest) return;
+            if ((int)inputs.size() < tierRatio) continue;
+            long long total = 0;
+            for (const Tier& tier : inputs) total += tier.records;
+            mergeAll(inputs, std::max(level + 1, levelOf(total)));
+        }
+    }
+
+    // Archivos por mezcla: a, o los buffers de bloque (uno por archivo + el de salida) que quepan en la arena si el gobernador adapta
+    int mergeFanIn() const {
+        if (!memory_governor.adapts()) return a;
+        size_t block_bytes = (recordsPerBlock * sizeof(Record) + MemoryGovernor::ALIGNMENT - 1) / MemoryGovernor::ALIGNMENT * MemoryGovernor::ALIGNMENT;
+        return (int)std::clamp<size_t>(memory_governor.available() / block_bytes - 1, 2, a);
+    }
+
+    void mergeAll(std::vector<Tier> inputs, int level) {
+        /* Mezcla inputs en un solo archivo del nivel dado; si son más que el fan-in, primero los mezcla por grupos de archivos
+        consecutivos (pasadas como las de mergeRuns), y los resultados intermedios quedan anotados con el nivel de su tamaño
+        args:
+            inputs: archivos a mezclar, en el orden del almacén
+            level: nivel del resultado
+        returns:
+            void
+        */
+
+        int fan_in = mergeFanIn();
+        while ((int)inputs.size() > fan_in) {
+            std::vector<Tier> outputs;
+            for (size_t group = 0; group < inputs.size(); group += fan_in) {
+                std::vector<Tier> members(inputs.begin() + group, inputs.begin() + std::min(inputs.size(), group + fan_in));
+                if (members.size() == 1) {
+                    outputs.push_back(members[0]);
+                    continue;
+                }
+                long long total = 0;
+                for (const Tier& tier : members) total += tier.records;
+                Tier output = mergeTiers(members, levelOf(total));
+                replace(members, output);
+                outputs.push_back(output);
+            }
+            inputs = outputs;
+        }
+        if (inputs.size() > 1) replace(inputs, mergeTiers(inputs, level));
+    }
+
+    // Anota output en el lugar del primero de inputs (así los archivos siguen en el orden en que llegaron sus registros) y
+    // después borra los archivos de inputs
+    void replace(const std::vector<Tier>& inputs, const Tier& output) {
+        std::vector<Tier> kept;
+        bool placed = false;
+        for (const Tier& tier : tierFiles) {
+            bool merged = std::any_of(inputs.begin(), inputs.end(), [&](const Tier& input) { return input.file == tier.file; });
+            if (!merged) {
+                kept.push_back(tier);
+            } else if (!placed) {
+                kept.push_back(output);
+                placed = true;
+            }
+        }
+        if (!placed) kept.push_back(output);
+        tierFiles = kept;
+        save();
+        for (const Tier& tier : inputs) {
+            std::filesystem::remove(tier.file);
+            std::filesystem::remove(tier.file + ".fence");
+        }
+    }
+
+    Tier mergeTiers(const std::vector<Tier>& inputs, int level) {
+        /* Mezcla archivos del almacén en uno nuevo del nivel dado, escribiendo su índice disperso en la misma pasada
+        args:
+            inputs: archivos a mezclar
+            level: nivel del resultado
+        returns:
+            el archivo nuevo
+        */
+
+        std::string output = nextFile();
+        FILE* out = fopen(output.c_str(), "wb");
+        if (!out) {
+            perror(("Error opening " + output).c_str());
+            exit(EXIT_FAILURE);
+        }
+        FenceIndexBuilder<Key> fence(recordsPerBlock, 1);
+        ArenaVector<Record> buffer(recordsPerBlock);
+        long buffered = 0;
+        long long written = 0;
+        auto flush = [&] {
+            fwrite(buffer.data(), sizeof(Record), buffered, out);
+            countIO++;
+            fence.add(written, buffer.data(), buffered, key);
+            written += buffered;
+            buffered = 0;
+        };
+
+        std::vector<std::string> files;
+        for (const Tier& tier : inputs) files.push_back(tier.file);
+        mergeFiles(files, [&](const Record& record) {
+            buffer[buffered++] = record;
+            if (buffered == recordsPerBlock) flush();
+        });
+        if (buffered > 0) flush();
+        fflush(out);
+        fsync(fileno(out));
+        fclose(out);
+        fence.save(output + ".fence", sizeof(Record), written);
+        return {level, written, output};
+    }
+
+    // Mezcla de archivos ordenados con un bloque en memoria por archivo; fn recibe los registros en orden
+    // (con llaves iguales, primero los del archivo anotado antes)
+    template <typename Fn>
+    void mergeFiles(const std::vector<std::string>& files, Fn fn) {
+        struct Reader {
+            FILE* file;
+            ArenaVector<Record> block;
+            size_t position = 0;
+        };
+        std::vector<Reader> readers;
+        readers.reserve(files.size());
+        auto refill = [&](Reader& reader) {
+            reader.block.resize(recordsPerBlock);
+            reader.block.resize(fread(reader.block.data(), sizeof(Record), recordsPerBlock, reader.file));
+            reader.position = 0;
+            if (reader.block.empty()) return false;
+            countIO++;
+            return true;
+        };
+        auto greater = [this, &readers](int x, int y) {
+            const Record& rx = readers[x].block[readers[x].position];
+            const Record& ry = readers[y].block[readers[y].position];
+            if (comp(key(ry), key(rx))) return true;
+            return !comp(key(rx), key(ry)) && y < x;
+        };
+        std::priority_queue<int, std::vector<int>, decltype(greater)> heap(greater);
+        for (const std::string& name : files) {
+            FILE* file = fopen(name.c_str(), "rb");
+            if (!file) {
+                perror(("Error opening " + name).c_str());
+                exit(EXIT_FAILURE);
+            }
+            readers.push_back({file, ArenaVector<Record>()});
+        }
+        for (int i = 0; i < (int)readers.size(); ++i) {
+            if (refill(readers[i])) heap.push(i);
+        }
+        while (!heap.empty()) {
+            int i = heap.top();
+            heap.pop();
+            Reader& reader = readers[i];
+            fn(reader.block[reader.position++]);
+            if (reader.position < reader.block.size() || refill(reader)) heap.push(i);
+        }
+        for (Reader& reader : readers) fclose(reader.file);
+    }
+};
+
+#endif
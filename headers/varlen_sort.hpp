@@ -0,0 +1,33 @@
+// Header para el ordenamiento externo de registros de largo variable (líneas de log)
+#ifndef VARLEN_SORT_HPP
+#define VARLEN_SORT_HPP
+
+#include <cstdint>
+#include <string>
+
+// Formato de los registros del archivo de entrada (la salida se escribe en el mismo formato)
+enum class VarlenFormat {
+    NEWLINE,          // un registro por línea, terminado en '\n'
+    LENGTH_PREFIXED   // largo en 4 bytes (uint32) seguido de los bytes del registro
+};
+
+// Llave de cada registro (se compara como bytes, en orden lexicográfico): primero el campo field si hay separador, y dentro
+// de él (o del registro completo) los length bytes desde offset. Por defecto es el registro completo. Un registro con menos
+// campos o más corto que offset tiene llave vacía (va primero)
+struct VarlenKey {
+    char delimiter = 0;     // separador de campos (0 = sin campos)
+    int field = 0;          // campo de la llave, desde 0 (solo con separador)
+    std::uint32_t offset = 0;
+    std::uint32_t length = 0;  // 0 = hasta el final del campo o del registro
+};
+
+// Lee una llave de la línea de comandos: "campo:<n>[:<separador>]" (separador espacio por defecto, "\t" = tabulación)
+// o "bytes:<offset>:<largo>"; retorna false si no tiene ninguno de esos formatos
+bool parse_varlen_key(const std::string& spec, VarlenKey& key);
+
+// Ordena los registros de inputFile por su llave (orden lexicográfico de bytes, p.ej. un timestamp ISO o un campo con el
+// timestamp) y escribe el resultado en outputFile; retorna el número de accesos a disco
+long long run_varlen_sort(const std::string& inputFile, const std::string& outputFile, VarlenFormat format,
+                          int a, long B_SIZE_arg, long M_SIZE_arg, const VarlenKey& key = VarlenKey());
+
+#endif
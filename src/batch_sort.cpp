@@ -0,0 +1,196 @@
+//ordenamiento por lotes: muchos archivos (p.ej. los shards de logs de una noche) en un mismo proceso, con un mergesort por trabajo
+//y un SortContext propio cada uno (headers/sort_context.hpp), así que sus temporales y contadores no chocan.
+// 1) Admisión: hasta max_jobs trabajos a la vez, los más grandes primero (LPT: el más largo no queda solo al final del lote,
+//    que es lo que alarga el makespan)
+// 2) Memoria: cada trabajo recibe al entrar su parte del presupuesto (presupuesto / trabajos que quedan, a lo más max_jobs),
+//    sin pasar del tamaño de su archivo y con al menos (a + 1) bloques; la devuelve al terminar. Al final del lote quedan
+//    menos trabajos y cada uno recibe más memoria (menos tramos, menos pasadas). La parte es fija y se reserva bajo el lock
+//    del planificador; el trabajo la usa como su cuenta en el gobernador (MemoryGovernor::Account), así que lo que ve
+//    disponible no lo consume otro trabajo, y sus fases (máximo de la arena, tiempo) se registran aparte
+// 3) Ancho de banda: la formación de tramos (lectura secuencial + sort en memoria, dominada por CPU) no se limita, pero a lo
+//    más io_slots trabajos mezclan a la vez (la mezcla intercala lecturas de a tramos y es la fase de E/S). Mientras unos
+//    mezclan, los demás forman tramos. Entre los que esperan turno de mezcla pasa primero el de menos datos por mover (su
+//    archivo por las pasadas que le faltan), que es el más cercano a terminar y el que antes libera su memoria. Entre dos
+//    pasadas el trabajo devuelve el turno y vuelve a la fila con lo que le queda, así que uno largo que va en su última
+//    pasada no queda detrás de los chicos que recién empiezan
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <mutex>
+#include <set>
+#include <thread>
+#include "../headers/batch_sort.hpp"
+#include "../headers/external_sorter.hpp"
+#include "../headers/planner.hpp"
+#include "../headers/sort_context.hpp"
+
+using namespace std;
+
+// --------------------------------- Planificador ---------------------------------
+
+class BatchScheduler {
+public:
+    BatchScheduler(long long memory_budget, int io_slots, int pending_jobs)
+        : freeMemory(memory_budget), memoryBudget(memory_budget), freeIoSlots(io_slots), pendingJobs(pending_jobs) {}
+
+    long acquireMemory(long long job_bytes, long minimum, int max_jobs) {
+        /* Reserva la memoria de un trabajo que empieza: su parte del presupuesto entre los trabajos que quedan
+        args:
+            job_bytes: tamaño del archivo del trabajo (no se le da más memoria que eso)
+            minimum: memoria mínima para ordenar (a + 1 bloques)
+            max_jobs: trabajos simultáneos
+        returns:
+            bytes reservados (M del trabajo)
+        */
+
+        unique_lock<mutex> lock(mutex_);
+        long long share = memoryBudget / max(1, min(max_jobs, pendingJobs + activeJobs));
+        long long want = max<long long>(minimum, min(share, job_bytes));
+        // Se espera a que quede al menos el mínimo libre (sin trabajos activos se entra igual: el presupuesto no alcanza ni para uno)
+        changed.wait(lock, [&] { return freeMemory >= minimum || activeJobs == 0; });
+        long long granted = min(want, max<long long>(freeMemory, minimum));
+        freeMemory -= granted;
+        pendingJobs--;
+        activeJobs++;
+        return granted;
+    }
+
+    void releaseMemory(long long bytes) {
+        lock_guard<mutex> lock(mutex_);
+        freeMemory += bytes;
+        activeJobs--;
+        changed.notify_all();
+    }
+
+    void acquireIo(long long remaining_bytes, long id) {
+        /* Espera un turno de mezcla; entre los que esperan pasa primero el de menos datos por mover
+        args:
+            remaining_bytes: datos que le quedan por mover al trabajo en la mezcla
+            id: identificador del trabajo (desempata)
+        returns:
+            void
+        */
+
+        unique_lock<mutex> lock(mutex_);
+        pair<long long, long> ticket = {remaining_bytes, id};
+        waitingIo.insert(ticket);
+        changed.wait(lock, [&] { return freeIoSlots > 0 && *waitingIo.begin() == ticket; });
+        waitingIo.erase(waitingIo.begin());
+        freeIoSlots--;
+        changed.notify_all();  // el siguiente de la fila puede tomar otro turno libre
+    }
+
+    void releaseIo() {
+        lock_guard<mutex> lock(mutex_);
+        freeIoSlots++;
+        changed.notify_all();
+    }
+
+private:
+    mutex mutex_;
+    condition_variable changed;
+    long long freeMemory;
+    long long memoryBudget;
+    int freeIoSlots;
+    int pendingJobs;
+    int activeJobs = 0;
+    set<pair<long long, long>> waitingIo;  // (bytes por mover, trabajo) en espera de turno
+};
+
+static int mergePasses(long long bytes, long M_SIZE, int a) {
+    // Pasadas de mezcla de un archivo de bytes con tramos de M_SIZE y aridad a (la última escribe la salida)
+    long long runs = max(1LL, (bytes + M_SIZE - 1) / max(1L, M_SIZE));
+    int passes = 1;
+    for (; runs > a; runs = (runs + a - 1) / a) passes++;
+    return passes;
+}
+
+// --------------------------------- Función para runnear en main.cpp ---------------------------------
+
+vector<BatchJobResult> run_batch_sort(const vector<string>& files, const BatchSortOptions& options) {
+    /* Ordena un lote de archivos de enteros de 64 bits a la vez, repartiendo la memoria y los turnos de mezcla
+    args:
+        files: archivos a ordenar (cada uno se escribe en archivo + ".sorted")
+        options: presupuesto de memoria, B, a, trabajos simultáneos y mezclas simultáneas
+    returns:
+        resultados por archivo, en el orden de files
+    */
+
+    int a = max(2, options.a);
+    int max_jobs = options.max_jobs > 0 ? options.max_jobs : max(1u, thread::hardware_concurrency());
+    max_jobs = min<int>(max_jobs, max<size_t>(1, files.size()));
+    // Tamaño de bloque y turnos de mezcla del perfil del dispositivo (./main calibrate), para la parte de M de un trabajo
+    long B_SIZE = options.B_SIZE > 0 ? options.B_SIZE : profile_block_size(options.memory_budget / max_jobs, a, options.temp_directory);
+    int io_slots = options.io_slots;
+    if (io_slots <= 0) {
+        DeviceProfile profile;
+        io_slots = load_device_profile(options.temp_directory, profile) ? max(1, profile.recommended_queue_depth) : 1;
+    }
+    long minimum = (long)(a + 1) * B_SIZE;
+
+    // Trabajos en orden de admisión: los más grandes primero
+    vector<long long> sizes(files.size());
+    vector<size_t> order(files.size());
+    for (size_t i = 0; i < files.size(); ++i) {
+        error_code error;
+        sizes[i] = (long long)filesystem::file_size(files[i], error);
+        order[i] = i;
+    }
+    stable_sort(order.begin(), order.end(), [&](size_t x, size_t y) { return sizes[x] > sizes[y]; });
+
+    vector<BatchJobResult> results(files.size());
+    BatchScheduler scheduler(options.memory_budget, io_slots, (int)files.size());
+    atomic<size_t> next{0};
+    auto batchStart = chrono::steady_clock::now();
+    auto elapsed = [&] { return (long long)chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - batchStart).count(); };
+
+    auto worker = [&] {
+        for (size_t position = next++; position < order.size(); position = next++) {
+            size_t job = order[position];
+            BatchJobResult& result = results[job];
+            result.input = files[job];
+            result.output = files[job] + ".sorted";
+            result.start_ms = elapsed();
+            result.M_SIZE = scheduler.acquireMemory(sizes[job], minimum, max_jobs);
+
+            // Los buffers del trabajo se cuentan contra su parte de M
+            MemoryGovernor::Account account;
+            account.budget = result.M_SIZE;
+            MemoryGovernor::useAccount(&account);
+
+            // La mezcla espera su turno (y lo devuelve entre pasadas); la formación de tramos corre sin esperar
+            SortContext context(B_SIZE, result.M_SIZE, a, options.temp_directory);
+            bool holdsIo = false;
+            result.io_wait_ms = 0;
+            auto waitIo = [&](int passes_left) {
+                long long waitStart = elapsed();
+                scheduler.acquireIo(sizes[job] * passes_left, (long)job);
+                result.io_wait_ms += elapsed() - waitStart;
+                holdsIo = true;
+            };
+            context.on_phase = [&](bool io_bound) {
+                if (io_bound && !holdsIo) waitIo(mergePasses(sizes[job], result.M_SIZE, a));
+            };
+            context.on_merge_pass = [&](int passes_left) {
+                if (holdsIo) scheduler.releaseIo();
+                waitIo(passes_left);
+            };
+
+            ExternalSorter<int64_t> sorter(context);
+            result.disk_access = sorter.mergesort(result.input, result.output);
+            if (holdsIo) scheduler.releaseIo();
+            MemoryGovernor::useAccount(nullptr);
+            result.phases = account.phases;
+            scheduler.releaseMemory(result.M_SIZE);
+            result.end_ms = elapsed();
+        }
+    };
+
+    vector<thread> workers;
+    for (int i = 0; i < max_jobs; ++i) workers.emplace_back(worker);
+    for (thread& t : workers) t.join();
+    return results;
+}
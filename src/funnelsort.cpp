@@ -0,0 +1,239 @@
+//se define N_SIZE <- número de elementos a ordenar (input)
+//M_SIZE, B_SIZE y a no los usa el algoritmo: es cache-oblivious, así que no conoce ni la memoria ni el bloque
+
+//funnelsort perezoso (Brodal y Fagerberg):
+//la entrada y la salida se mapean a memoria (mmap) y el sistema decide qué páginas quedan en RAM y cuándo se escriben,
+//así que el "cache" es la memoria que el sistema tenga libre, sea cual sea su tamaño
+//si N_SIZE <= FUNNEL_BASE_CASE
+// se ordena con sort (el caso base es una constante del algoritmo, no depende de la máquina)
+//else N_SIZE > FUNNEL_BASE_CASE
+// 1) Se divide el arreglo en k = ⌈N^(1/3)⌉ segmentos de N^(2/3) elementos y se ordena cada uno recursivamente
+// 2) Se mezclan los k segmentos con un k-funnel: un árbol binario de mezcladores donde cada arista tiene un buffer.
+//    El tamaño de los buffers sale de la división recursiva del árbol por la mitad de su altura: los buffers entre el
+//    funnel de arriba y los de abajo de un sub-funnel con k' hojas tienen k'^(3/2) elementos, y se ubican en memoria en
+//    el mismo orden recursivo (van Emde Boas), así que cada sub-funnel ocupa un tramo contiguo
+// 3) Mezcla perezosa: un nodo se llena (fill) mezclando los buffers de sus hijos, y un hijo se vuelve a llenar solo cuando
+//    su buffer se vacía; con eso se alcanzan O((N/B) log_{M/B}(N/B)) transferencias para cualquier M y B (con cache alto)
+// 4) La mezcla se escribe en un arreglo auxiliar (un archivo temporal mapeado) y se copia de vuelta al segmento
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#include "../headers/funnelsort.hpp"
+#include "../headers/planner.hpp"
+
+using namespace std;
+
+const long FUNNEL_BASE_CASE = 64;  // segmentos de a lo más este tamaño se ordenan directo
+
+class Funnel {
+    /* k-funnel sobre k segmentos ordenados: los nodos se numeran como en un heap (raíz 1, hijos 2v y 2v+1), los
+    mezcladores son 1..2^h-1 y las hojas 2^h..2^(h+1)-1 son los segmentos (las que sobran quedan vacías) */
+public:
+    Funnel(const vector<int64_t*>& begins, const vector<int64_t*>& ends) {
+        while ((1L << height) < (long)begins.size()) height++;
+        leafStart = 1L << height;
+        pos.assign(2 * leafStart, nullptr);
+        end.assign(2 * leafStart, nullptr);
+        for (size_t i = 0; i < begins.size(); ++i) {
+            pos[leafStart + i] = begins[i];
+            end[leafStart + i] = ends[i];
+        }
+        depthCapacity.assign(height + 1, 0);
+        sizes(0, height);
+        offset.assign(leafStart, 0);
+        capacity.assign(leafStart, 0);
+        exhausted.assign(leafStart, false);
+        long long total = 0;
+        layout(1, 0, height, total);
+        arena.resize(total);
+    }
+
+    void merge(int64_t* out, long long n) {
+        // La raíz escribe directo en la salida, que tiene espacio para todo
+        fill(1, out, n);
+    }
+
+private:
+    int height = 0;
+    long leafStart = 0;
+    vector<long long> depthCapacity;  // tamaño de los buffers de los nodos de cada profundidad
+    vector<long long> offset;         // inicio del buffer de cada mezclador en arena
+    vector<long long> capacity;
+    vector<bool> exhausted;           // el mezclador ya entregó todo lo de su subárbol
+    vector<int64_t*> pos, end;        // lo que queda por consumir del buffer (o del segmento) de cada nodo
+    vector<int64_t> arena;
+
+    void sizes(int top, int h) {
+        // Sub-funnel con raíz a profundidad top y altura h: buffers de la profundidad donde se corta, y recursión arriba y abajo
+        if (h <= 1) return;
+        int upper = h / 2;
+        depthCapacity[top + upper] = (long long)ceil(pow(2.0, 1.5 * h));
+        sizes(top, upper);
+        sizes(top + upper, h - upper);
+    }
+
+    void layout(long v, int top, int h, long long& total) {
+        // Orden van Emde Boas: primero el funnel de arriba, luego cada funnel de abajo precedido por el buffer de su raíz
+        if (h <= 1) return;
+        int upper = h / 2;
+        layout(v, top, upper, total);
+        for (long u = v << upper; u < (v + 1) << upper; ++u) {
+            offset[u] = total;
+            capacity[u] = depthCapacity[top + upper];
+            total += capacity[u];
+            layout(u, top + upper, h - upper, total);
+        }
+    }
+
+    void refill(long v) {
+        int64_t* start = arena.data() + offset[v];
+        pos[v] = start;
+        end[v] = start + fill(v, start, capacity[v]);
+    }
+
+    long long fill(long v, int64_t* out, long long cap) {
+        /* Mezcla los buffers de los hijos de v en out hasta llenarlo o agotar el subárbol
+        args:
+            v: mezclador
+            out: buffer de salida de v
+            cap: tamaño de out
+        returns:
+            elementos escritos
+        */
+
+        long left = 2 * v, right = 2 * v + 1;
+        long long filled = 0;
+        while (filled < cap) {
+            if (pos[left] == end[left] && left < leafStart && !exhausted[left]) refill(left);
+            if (pos[right] == end[right] && right < leafStart && !exhausted[right]) refill(right);
+            int64_t*& l = pos[left];
+            int64_t*& r = pos[right];
+            if (l == end[left] && r == end[right]) {
+                exhausted[v] = true;
+                break;
+            }
+            if (l == end[left] || r == end[right]) {
+                // Queda un solo hijo con datos: se copia lo que haya sin comparar
+                int64_t*& rest = l == end[left] ? r : l;
+                long long count = min<long long>((l == end[left] ? end[right] : end[left]) - rest, cap - filled);
+                copy(rest, rest + count, out + filled);
+                rest += count;
+                filled += count;
+                continue;
+            }
+            while (l != end[left] && r != end[right] && filled < cap) out[filled++] = *r < *l ? *r++ : *l++;
+        }
+        return filled;
+    }
+};
+
+void funnelsort(int64_t* data, int64_t* scratch, long long n) {
+    /* Ordena data[0, n) en el lugar
+    args:
+        data: arreglo a ordenar
+        scratch: arreglo auxiliar de n elementos
+        n: número de elementos
+    */
+
+    if (n <= FUNNEL_BASE_CASE) {
+        sort(data, data + n);
+        return;
+    }
+    long long k = (long long)ceil(cbrt((double)n));
+    long long segment = (n + k - 1) / k;
+    vector<int64_t*> begins, ends;
+    for (long long start = 0; start < n; start += segment) {
+        long long length = min(segment, n - start);
+        funnelsort(data + start, scratch + start, length);
+        begins.push_back(data + start);
+        ends.push_back(data + start + length);
+    }
+    Funnel funnel(begins, ends);
+    funnel.merge(scratch, n);
+    copy(scratch, scratch + n, data);
+}
+
+int64_t* mapFile(const string& filename, long long bytes, bool create) {
+    /* Mapea un archivo completo a memoria, compartido (las escrituras llegan al archivo)
+    args:
+        filename: archivo a mapear
+        bytes: tamaño del archivo
+        create: crear (o truncar) el archivo con ese tamaño
+    returns:
+        puntero al mapa o nullptr si falla
+    */
+
+    int fd = create ? open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644) : open(filename.c_str(), O_RDONLY);
+    if (fd < 0) return nullptr;
+    if (create && ftruncate(fd, bytes) != 0) {
+        close(fd);
+        return nullptr;
+    }
+    void* mapped = mmap(nullptr, bytes, create ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    return mapped == MAP_FAILED ? nullptr : static_cast<int64_t*>(mapped);
+}
+
+long long run_funnelsort(const std::string& inputFile, long N_SIZE, int a, long B_SIZE_arg, long M_SIZE_arg) {
+    /* Función principal para ejecutar el Funnelsort perezoso
+    args:
+        inputFile: nombre del archivo de entrada
+        N_SIZE: número total de elementos en el archivo
+        a: no se usa (misma firma que los demás algoritmos)
+        B_SIZE_arg: tamaño del bloque en bytes con que se reportan los accesos (0 = el del perfil del dispositivo); el
+                    algoritmo no lo usa
+        M_SIZE_arg: no se usa para ordenar (solo para elegir el bloque del perfil)
+    returns:
+        número de accesos al disco o -1 si hay un error
+    */
+
+    if (B_SIZE_arg <= 0) B_SIZE_arg = profile_block_size(M_SIZE_arg, a);
+    const string outputFile = inputFile + ".funnel.sorted";
+    const string scratchFile = inputFile + ".funnel.tmp";
+    const long long bytes = (long long)N_SIZE * (long long)sizeof(int64_t);
+
+    // El algoritmo no cuenta sus transferencias (no sabe de bloques): se miden los bloques que el sistema lee y escribe
+    // por el proceso mientras ordena, incluida la escritura final de la salida
+    struct rusage before, after;
+    getrusage(RUSAGE_SELF, &before);
+
+    if (N_SIZE <= 0) {
+        FILE* empty = fopen(outputFile.c_str(), "wb");
+        if (empty) fclose(empty);
+        return 0;
+    }
+    int64_t* input = mapFile(inputFile, bytes, false);
+    int64_t* output = mapFile(outputFile, bytes, true);
+    // El auxiliar se respalda en un archivo (y no en memoria anónima) para que el sistema pueda sacarlo de RAM; se borra
+    // apenas se mapea, así no queda si el programa se cae
+    int64_t* scratch = mapFile(scratchFile, bytes, true);
+    remove(scratchFile.c_str());
+    if (!input || !output || !scratch) {
+        cerr << "No puedo mapear " << inputFile << " o sus archivos de salida" << endl;
+        if (input) munmap(input, bytes);
+        if (output) munmap(output, bytes);
+        if (scratch) munmap(scratch, bytes);
+        return -1;
+    }
+
+    copy(input, input + N_SIZE, output);
+    munmap(input, bytes);
+    funnelsort(output, scratch, N_SIZE);
+    munmap(scratch, bytes);
+    msync(output, bytes, MS_SYNC);
+    munmap(output, bytes);
+
+    getrusage(RUSAGE_SELF, &after);
+    // ru_inblock y ru_oublock cuentan unidades de 512 bytes
+    long long transferred = (after.ru_inblock - before.ru_inblock + after.ru_oublock - before.ru_oublock) * 512LL;
+    return (transferred + B_SIZE_arg - 1) / B_SIZE_arg;
+}
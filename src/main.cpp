@@ -10,6 +10,29 @@
 //funcion que determina a
 //experimentalmente se busca el a optimo usando mergesort, luego de tenerlo ya queda fijo y se usa de ahí en adelante
 //por ello no forma parte del main
+//con "./main <M_SIZE MB> auto" el planificador (planner.cpp) elige algoritmo, a y B para cada N a partir de una calibración
+//del dispositivo y guarda lo predicho junto a lo medido en planner_results.csv
+//con "./main calibrate [directorio]" se mide el dispositivo (bloques de 4 KB a 16 MB, varias profundidades de cola) y se guarda
+//el perfil en device_profile.txt; con B_SIZE = 0 los algoritmos usan el bloque recomendado por ese perfil
+//el cuarto argumento opcional fija la política del gobernador de memoria (memory_governor.hpp): todos los buffers salen de
+//una arena de tamaño M y "adapt" (por defecto) ajusta los pedidos a lo disponible, "strict" termina si un pedido no cabe
+//y "unlimited" usa el heap sin límite; después de cada archivo se imprime el máximo de la arena y el pico de RSS por fase
+//el quinto argumento opcional elige las páginas de la arena: "thp" (por defecto, MADV_HUGEPAGE), "hugetlb" o "normal"
+//con "./main sort <archivo> <M_SIZE MB> <B_SIZE> <a>" se ordena un archivo existente con mergesort y checkpoints (archivo.sorted y
+//su manifiesto); si el proceso muere, "./main resume <archivo>" sigue desde el último tramo o mezcla completa
+//con "./main batch <M_SIZE MB> <B_SIZE> <a> <trabajos> <archivo>..." se ordena un lote de archivos a la vez (batch_sort.cpp):
+//M es el presupuesto de todo el lote, que se reparte entre los trabajos activos junto con los turnos de mezcla
+//con "./main shard <archivo> <M_SIZE MB> <B_SIZE> <a> <shards>" el mergesort escribe la salida en shards por rango de llave
+//(archivo.sorted.shard<i>) y un índice con la primera y última llave de cada uno (archivo.sorted.shards)
+//con "./main fence <archivo> <M_SIZE MB> <B_SIZE> <a> <k>" el mergesort escribe además un índice disperso de la salida con la
+//primera llave de cada k bloques (archivo.sorted.fence), y "./main range <archivo.sorted> <desde> <hasta>" lo usa para leer un rango
+//con "./main append <base> <lote> <M_SIZE MB> <B_SIZE> <a> [razón]" se agrega un lote al almacén por niveles de base (tiered_store.hpp)
+//ordenando solo el lote, y "./main compact <base> <M_SIZE MB> <B_SIZE> <a>" deja el almacén en un solo archivo ordenado
+//con "./main merge <salida> <M_SIZE MB> <B_SIZE> <a> <archivo>..." se mezclan archivos ya ordenados sin formar tramos
+//con "./main varlen <archivo> <M_SIZE MB> <B_SIZE> <a> [lineas|largo] [llave]" se ordena un log de registros de largo variable
+//(varlen_sort.cpp) en archivo.sorted, por el registro completo o por la llave "campo:<n>[:<separador>]" o "bytes:<offset>:<largo>"
+//el experimento corre además el funnelsort perezoso (funnelsort.cpp), cache-oblivious: no usa M ni B, y sus accesos a disco
+//son los bloques que el sistema lee y escribe por el proceso (no un conteo del algoritmo)
 
 //main:
     
@@ -36,6 +59,13 @@
 #include "sequence_generator.hpp"
 #include "../headers/quicksort.hpp" 
 #include "../headers/mergesort.hpp"
+#include "../headers/radixsort.hpp"
+#include "../headers/funnelsort.hpp"
+#include "../headers/planner.hpp"
+#include "../headers/memory_governor.hpp"
+#include "../headers/sort_manifest.hpp"
+#include "../headers/batch_sort.hpp"
+#include "../headers/varlen_sort.hpp"
 #include <list>
 
 using namespace std;
@@ -78,16 +108,37 @@ bool checkSorted(FILE* file, long input_size) {
     }
 }
 
+void prefault_inputs(const vector<string>& files) {
+    /* Pre-toca de la arena lo que van a usar los ordenamientos de estos archivos: min(M, suma de sus tamaños)
+    args:
+        files: archivos de entrada
+    returns:
+        void
+    */
+
+    size_t total = 0;
+    for (const string& file : files) {
+        error_code error;
+        uintmax_t size = filesystem::file_size(file, error);
+        if (!error) total += size;
+    }
+    memory_governor.prefault(total);
+}
+
 struct AlgorithmResults {
     long long merge_time_ms;
     long long merge_disk_access;
     long long quick_time_ms;
     long long quick_disk_access;
+    long long radix_time_ms;
+    long long radix_disk_access;
+    long long funnel_time_ms;
+    long long funnel_disk_access;
 };
 
 
 AlgorithmResults process_sequence(const std::string& filename, long N_SIZE, int a, long B_SIZE, long M_SIZE) {
-    AlgorithmResults results = {0, 0, 0, 0};
+    AlgorithmResults results = {0, 0, 0, 0, 0, 0, 0, 0};
     /*
     Función para procesar la secuencia aleatoria generada (del tamaño definido como múltiplo de M), 
     ejecutando los algoritmos de ordenamiento y midiendo el tiempo y accesos a disco
@@ -105,7 +156,7 @@ AlgorithmResults process_sequence(const std::string& filename, long N_SIZE, int
 
     // --------------------------- MERGESORT ---------------------------
     auto merge_start_time = std::chrono::high_resolution_clock::now();
-    int merge_sort_disk_access = run_mergesort(filename, N_SIZE, a, B_SIZE, M_SIZE);
+    long long merge_sort_disk_access = run_mergesort(filename, N_SIZE, a, B_SIZE, M_SIZE);
     auto merge_end_time = std::chrono::high_resolution_clock::now();
     auto merge_duration = std::chrono::duration_cast<std::chrono::milliseconds>(merge_end_time - merge_start_time);
     results.merge_time_ms = merge_duration.count();
@@ -124,22 +175,44 @@ AlgorithmResults process_sequence(const std::string& filename, long N_SIZE, int
     // fclose(file);
     
 
+    // --------------------------- RADIXSORT ---------------------------
+    // Se ejecuta (como funnelsort) antes que quicksort porque quicksort ordena el archivo de entrada en el lugar
+    auto radix_start_time = std::chrono::high_resolution_clock::now();
+    long long radix_sort_disk_access = run_radixsort(filename, N_SIZE / sizeof(int64_t), a, B_SIZE, M_SIZE);
+    auto radix_end_time = std::chrono::high_resolution_clock::now();
+    auto radix_duration = std::chrono::duration_cast<std::chrono::milliseconds>(radix_end_time - radix_start_time);
+    results.radix_time_ms = radix_duration.count();
+    results.radix_disk_access = radix_sort_disk_access;
+    std::cout << "RadixSort completado en " << results.radix_time_ms << " ms, con " 
+     << results.radix_disk_access << " accesos a disco" << std::endl;
+
+    // --------------------------- FUNNELSORT ---------------------------
+    // Cache-oblivious: recibe los mismos argumentos pero no usa M ni B para ordenar (B solo para reportar los accesos)
+    auto funnel_start_time = std::chrono::high_resolution_clock::now();
+    long long funnel_sort_disk_access = run_funnelsort(filename, N_SIZE / sizeof(int64_t), a, B_SIZE, M_SIZE);
+    auto funnel_end_time = std::chrono::high_resolution_clock::now();
+    auto funnel_duration = std::chrono::duration_cast<std::chrono::milliseconds>(funnel_end_time - funnel_start_time);
+    results.funnel_time_ms = funnel_duration.count();
+    results.funnel_disk_access = funnel_sort_disk_access;
+    std::cout << "FunnelSort completado en " << results.funnel_time_ms << " ms, con " 
+     << results.funnel_disk_access << " accesos a disco" << std::endl;
+
     // --------------------------- QUICKSORT ---------------------------
-    // // Start measuring time for quicksort
-    // auto quick_start_time = std::chrono::high_resolution_clock::now();
+    // Start measuring time for quicksort
+    auto quick_start_time = std::chrono::high_resolution_clock::now();
     
-    // // Here we call run_quicksort and pass the necessary arguments
-    // int quick_sort_disk_access = run_quicksort(filename, N_SIZE, a, B_SIZE, M_SIZE);
+    // Here we call run_quicksort and pass the necessary arguments (quicksort recibe el número de elementos, no de bytes)
+    long long quick_sort_disk_access = run_quicksort(filename, N_SIZE / sizeof(int64_t), a, B_SIZE, M_SIZE);
     
-    // // Stop measuring time
-    // auto quick_end_time = std::chrono::high_resolution_clock::now();
+    // Stop measuring time
+    auto quick_end_time = std::chrono::high_resolution_clock::now();
     
-    // // Calculate duration in milliseconds
-    // auto quick_duration = std::chrono::duration_cast<std::chrono::milliseconds>(quick_end_time - quick_start_time);
+    // Calculate duration in milliseconds
+    auto quick_duration = std::chrono::duration_cast<std::chrono::milliseconds>(quick_end_time - quick_start_time);
     
-    // // Store quicksort results
-    // results.quick_time_ms = quick_duration.count();
-    // results.quick_disk_access = quick_sort_disk_access;
+    // Store quicksort results
+    results.quick_time_ms = quick_duration.count();
+    results.quick_disk_access = quick_sort_disk_access;
     
     // // Check if the file is sorted
     // FILE* file2 = fopen(filename.c_str(), "rb");
@@ -150,23 +223,238 @@ AlgorithmResults process_sequence(const std::string& filename, long N_SIZE, int
     // bool __ = checkSorted(file2, N_SIZE);
     // fclose(file2);
 
-    // // Print results
-    // cout << "QuickSort completado en " << results.quick_time_ms << " ms, con " 
-    //      << results.quick_disk_access << " accesos a disco" << endl;
+    // Print results
+    cout << "QuickSort completado en " << results.quick_time_ms << " ms, con " 
+         << results.quick_disk_access << " accesos a disco" << endl;
+    memory_governor.report(cout);
          
     return results;
 }
 
+int run_planned_experiment(int64_t M_BYTES, long M_MB) {
+    /* Experimento con el planificador automático: para cada N se elige algoritmo, a y B, se ejecuta el plan
+    y se guarda la predicción junto al resultado medido
+    args:
+        M_BYTES: tamaño de la memoria principal en bytes
+        M_MB: tamaño de la memoria principal en MB (para la columna Size_MB)
+    returns:
+        código de salida del programa
+    */
+
+    ofstream planner_csv("planner_results.csv");
+    if (!planner_csv) {
+        cerr << "Error: No se pudo crear el archivo CSV del planificador.\n";
+        return EXIT_FAILURE;
+    }
+    planner_csv << "Size_MB,N_elements,Algorithm,a,B_SIZE,Buffer_Bytes,Predicted_Time_ms,Measured_Time_ms,"
+                << "Predicted_Disk_Access,Measured_Disk_Access\n";
+
+    DeviceCalibration device = calibrate_device(".");
+    cout << "Calibración: lectura " << device.seq_read_mb_s << " MB/s, escritura " << device.seq_write_mb_s
+         << " MB/s, latencia " << device.access_latency_ms << " ms, " << device.cpu_ns_per_compare << " ns/comparación" << endl;
+
+    for (size_t i = 0; i < v.size(); ++i){
+        int mult = static_cast<int>((i + 1) * 4);
+        int64_t N = static_cast<int64_t>(v[i]) * M_BYTES;
+        SortPlan plan = plan_sort(N, M_BYTES, device);
+        cout << "\n=============  N = " << N << " bytes → " << algorithm_name(plan.algorithm)
+             << " con a = " << plan.a << ", B = " << plan.B_SIZE << "  =============\n";
+
+        ostringstream fn;
+        fn << "seq_" << setw(2) << setfill('0') << mult << "M_plan.bin";
+        generate_sequence(N, fn.str(), plan.B_SIZE);
+        PlanResult measured = run_plan(fn.str(), N, plan);
+
+        planner_csv << mult*M_MB << "," << N << "," << algorithm_name(plan.algorithm) << "," << plan.a << ","
+                    << plan.B_SIZE << "," << plan.buffer_bytes << "," << plan.predicted_time_ms << "," << measured.time_ms << ","
+                    << plan.predicted_disk_access << "," << measured.disk_access << "\n";
+        cout << "Predicho: " << plan.predicted_time_ms << " ms, " << plan.predicted_disk_access << " accesos; medido: "
+             << measured.time_ms << " ms, " << measured.disk_access << " accesos" << endl;
+        memory_governor.report(cout);
+
+        filesystem::remove(fn.str());
+        filesystem::remove(fn.str()+".sorted");
+    }
+
+    planner_csv.close();
+    cout << "\n✓ Experimento completo. Resultados guardados en planner_results.csv" << endl;
+    return EXIT_SUCCESS;
+}
+
 int main(int argc, char* argv[]){
-    if (argc != 4) {
+    if (argc >= 2 && string(argv[1]) == "calibrate") {
+        string directory = argc >= 3 ? argv[2] : ".";
+        DeviceProfile profile = probe_device(directory, 256L * 1024 * 1024);
+        if (!save_device_profile(profile, directory)) {
+            cerr << "Error: No se pudo guardar el perfil del dispositivo.\n";
+            return EXIT_FAILURE;
+        }
+        cout << "Bloque recomendado: " << profile.recommended_block_size << " bytes, profundidad de cola: "
+             << profile.recommended_queue_depth << ". Perfil guardado en " << DEVICE_PROFILE_FILE << endl;
+        return EXIT_SUCCESS;
+    }
+    if (argc == 6 && string(argv[1]) == "sort") {
+        int64_t M_BYTES = stol(argv[3]) * 1024L * 1024L;
+        memory_governor.configure(M_BYTES, MemoryGovernor::ADAPT);
+        prefault_inputs({argv[2]});
+        long long disk_access = run_mergesort_checkpointed(argv[2], stoi(argv[5]), stol(argv[4]), M_BYTES);
+        cout << "MergeSort con checkpoints completado con " << disk_access << " accesos a disco" << endl;
+        return EXIT_SUCCESS;
+    }
+    if (argc >= 7 && string(argv[1]) == "batch") {
+        BatchSortOptions options;
+        options.memory_budget = stol(argv[2]) * 1024L * 1024L;
+        options.B_SIZE = stol(argv[3]);
+        options.a = stoi(argv[4]);
+        options.max_jobs = stoi(argv[5]);
+        vector<string> files(argv + 6, argv + argc);
+        memory_governor.configure(options.memory_budget, MemoryGovernor::ADAPT);
+        prefault_inputs(files);
+        vector<BatchJobResult> results = run_batch_sort(files, options);
+        long long makespan = 0;
+        for (const BatchJobResult& result : results) {
+            cout << result.output << ": M " << (result.M_SIZE >> 10) << " KB, " << result.disk_access << " accesos a disco, inicio "
+                 << result.start_ms << " ms, espera de mezcla " << result.io_wait_ms << " ms, fin " << result.end_ms << " ms" << endl;
+            MemoryGovernor::printPhases(cout, result.phases);
+            makespan = max(makespan, result.end_ms);
+        }
+        cout << "Lote de " << results.size() << " archivos completado en " << makespan << " ms" << endl;
+        return EXIT_SUCCESS;
+    }
+    if (argc == 7 && string(argv[1]) == "shard") {
+        int64_t M_BYTES = stol(argv[3]) * 1024L * 1024L;
+        memory_governor.configure(M_BYTES, MemoryGovernor::ADAPT);
+        prefault_inputs({argv[2]});
+        long long disk_access = run_mergesort_sharded(argv[2], stoi(argv[5]), stol(argv[4]), M_BYTES, stoi(argv[6]));
+        cout << "MergeSort en " << argv[6] << " shards completado con " << disk_access << " accesos a disco (índice en "
+             << argv[2] << ".sorted.shards)" << endl;
+        return EXIT_SUCCESS;
+    }
+    if (argc == 7 && string(argv[1]) == "fence") {
+        int64_t M_BYTES = stol(argv[3]) * 1024L * 1024L;
+        memory_governor.configure(M_BYTES, MemoryGovernor::ADAPT);
+        prefault_inputs({argv[2]});
+        long long disk_access = run_mergesort_fenced(argv[2], stoi(argv[5]), stol(argv[4]), M_BYTES, stol(argv[6]));
+        cout << "MergeSort con índice disperso completado con " << disk_access << " accesos a disco (índice en "
+             << argv[2] << ".sorted.fence)" << endl;
+        return EXIT_SUCCESS;
+    }
+    if (argc == 5 && string(argv[1]) == "range") {
+        vector<long long> result;
+        long long block_reads = run_range_query(argv[2], stoll(argv[3]), stoll(argv[4]), result);
+        if (block_reads < 0) {
+            cerr << "Error: " << argv[2] << " no tiene un índice disperso vigente (" << argv[2] << ".fence).\n";
+            return EXIT_FAILURE;
+        }
+        cout << result.size() << " valores en [" << argv[3] << ", " << argv[4] << "]";
+        if (!result.empty()) cout << " (de " << result.front() << " a " << result.back() << ")";
+        cout << " con " << block_reads << " bloques leídos" << endl;
+        return EXIT_SUCCESS;
+    }
+    if ((argc == 7 || argc == 8) && string(argv[1]) == "append") {
+        int64_t M_BYTES = stol(argv[4]) * 1024L * 1024L;
+        memory_governor.configure(M_BYTES, MemoryGovernor::ADAPT);
+        prefault_inputs({argv[3]});
+        int tier_ratio = argc == 8 ? stoi(argv[7]) : 0;  // 0 = el del almacén (4 si es nuevo)
+        long long disk_access = run_append_batch(argv[2], argv[3], stoi(argv[6]), stol(argv[5]), M_BYTES, tier_ratio);
+        cout << "Lote agregado con " << disk_access << " accesos a disco" << endl;
+        return EXIT_SUCCESS;
+    }
+    if (argc == 6 && string(argv[1]) == "compact") {
+        int64_t M_BYTES = stol(argv[3]) * 1024L * 1024L;
+        memory_governor.configure(M_BYTES, MemoryGovernor::ADAPT);
+        long long disk_access = run_compact_store(argv[2], stoi(argv[5]), stol(argv[4]), M_BYTES);
+        cout << "Compactación completada con " << disk_access << " accesos a disco" << endl;
+        return EXIT_SUCCESS;
+    }
+    if (argc >= 7 && string(argv[1]) == "merge") {
+        int64_t M_BYTES = stol(argv[3]) * 1024L * 1024L;
+        memory_governor.configure(M_BYTES, MemoryGovernor::ADAPT);
+        vector<string> files(argv + 6, argv + argc);
+        prefault_inputs(files);
+        long long disk_access = run_merge_sorted(files, argv[2], stoi(argv[5]), stol(argv[4]), M_BYTES);
+        cout << "Mezcla de " << files.size() << " archivos ordenados completada con " << disk_access << " accesos a disco" << endl;
+        return EXIT_SUCCESS;
+    }
+    if (argc >= 6 && argc <= 8 && string(argv[1]) == "varlen") {
+        VarlenFormat format = VarlenFormat::NEWLINE;
+        VarlenKey key;
+        bool valid = true;
+        for (int i = 6; i < argc; ++i) {
+            string option = argv[i];
+            if (option == "lineas") format = VarlenFormat::NEWLINE;
+            else if (option == "largo") format = VarlenFormat::LENGTH_PREFIXED;
+            else valid = parse_varlen_key(option, key) && valid;
+        }
+        if (!valid) {
+            cerr << "Error: llave inválida (se espera campo:<n>[:<separador>] o bytes:<offset>:<largo>).\n";
+            return EXIT_FAILURE;
+        }
+        int64_t M_BYTES = stol(argv[3]) * 1024L * 1024L;
+        memory_governor.configure(M_BYTES, MemoryGovernor::ADAPT);
+        prefault_inputs({argv[2]});
+        long long disk_access = run_varlen_sort(argv[2], string(argv[2]) + ".sorted", format, stoi(argv[5]), stol(argv[4]), M_BYTES, key);
+        cout << "Ordenamiento de registros de largo variable completado con " << disk_access << " accesos a disco" << endl;
+        return EXIT_SUCCESS;
+    }
+    if (argc == 3 && string(argv[1]) == "resume") {
+        SortManifest::Header header;
+        if (!SortManifest::readHeader(string(argv[2]) + ".sorted.manifest", header)) {
+            cerr << "Error: No hay un ordenamiento interrumpido de " << argv[2] << ".\n";
+            return EXIT_FAILURE;
+        }
+        memory_governor.configure(header.M_SIZE, MemoryGovernor::ADAPT);
+        prefault_inputs({argv[2]});
+        long long disk_access = resume_mergesort(argv[2]);
+        if (disk_access < 0) {
+            cerr << "Error: El manifiesto de " << argv[2] << " no es de un archivo de enteros de 64 bits.\n";
+            return EXIT_FAILURE;
+        }
+        cout << "MergeSort retomado y completado con " << disk_access << " accesos a disco" << endl;
+        return EXIT_SUCCESS;
+    }
+    if (argc == 3 && string(argv[2]) == "auto") {
+        memory_governor.configure(stol(argv[1]) * 1024L * 1024L, MemoryGovernor::ADAPT);
+        memory_governor.prefault(stol(argv[1]) * 1024L * 1024L);  // las entradas del experimento son de varias veces M
+        return run_planned_experiment(stol(argv[1]) * 1024L * 1024L, stol(argv[1]));
+    }
+    MemoryGovernor::Policy policy = MemoryGovernor::ADAPT;
+    MemoryGovernor::Pages pages = MemoryGovernor::TRANSPARENT_HUGE_PAGES;
+    if (argc >= 5) {
+        string name = argv[4];
+        if (name == "strict") policy = MemoryGovernor::FAIL_FAST;
+        else if (name == "unlimited") policy = MemoryGovernor::UNLIMITED;
+        else if (name != "adapt") argc = 0;  // política desconocida: mostrar el uso
+    }
+    if (argc == 6) {
+        string name = argv[5];
+        if (name == "normal") pages = MemoryGovernor::NORMAL_PAGES;
+        else if (name == "hugetlb") pages = MemoryGovernor::EXPLICIT_HUGE_PAGES;
+        else if (name != "thp") argc = 0;  // páginas desconocidas: mostrar el uso
+    }
+    if (argc < 4 || argc > 6) {
         cerr << "Uso: " << argv[0]
-                  << " <M_SIZE MB> <B_SIZE bytes> <a particiones>\n";
+                  << " <M_SIZE MB> <B_SIZE bytes> <a particiones> [adapt|strict|unlimited] [thp|hugetlb|normal]\n"
+                  << "     " << argv[0] << " <M_SIZE MB> auto\n"
+                  << "     " << argv[0] << " calibrate [directorio]\n"
+                  << "     " << argv[0] << " sort <archivo> <M_SIZE MB> <B_SIZE bytes> <a particiones>\n"
+                  << "     " << argv[0] << " resume <archivo>\n"
+                  << "     " << argv[0] << " shard <archivo> <M_SIZE MB> <B_SIZE bytes> <a particiones> <shards>\n"
+                  << "     " << argv[0] << " fence <archivo> <M_SIZE MB> <B_SIZE bytes> <a particiones> <bloques por llave>\n"
+                  << "     " << argv[0] << " range <archivo ordenado> <desde> <hasta>\n"
+                  << "     " << argv[0] << " append <base> <lote> <M_SIZE MB> <B_SIZE bytes> <a particiones> [razón entre niveles]\n"
+                  << "     " << argv[0] << " compact <base> <M_SIZE MB> <B_SIZE bytes> <a particiones>\n"
+                  << "     " << argv[0] << " merge <salida> <M_SIZE MB> <B_SIZE bytes> <a particiones> <archivo>...\n"
+                  << "     " << argv[0] << " varlen <archivo> <M_SIZE MB> <B_SIZE bytes> <a particiones> [lineas|largo] [llave]\n"
+                  << "     " << argv[0] << " batch <M_SIZE MB> <B_SIZE bytes> <a particiones> <trabajos> <archivo>...\n";
         return EXIT_FAILURE;
     }
 
     const int64_t M_BYTES = stol(argv[1]) * 1024L * 1024L; // Tamaño de la memoria principal en bytes
-    const size_t B_SIZE = stol(argv[2]); // Tamaño del bloque en bytes
     const int a = stoi(argv[3]); // Número de particiones a realizar
+    const size_t B_SIZE = stol(argv[2]) > 0 ? stol(argv[2]) : profile_block_size(M_BYTES, a); // Tamaño del bloque en bytes (0 = perfil del dispositivo)
+    memory_governor.configure(M_BYTES, policy, pages); // Todos los buffers de los algoritmos salen de una arena de tamaño M
+    memory_governor.prefault(M_BYTES); // Las entradas son de al menos 4 M: se usa la arena completa
     
     // Creación del archivo CSV para guardar los resultados
     ofstream results_csv("sorting_results.csv");
@@ -177,7 +465,8 @@ int main(int argc, char* argv[]){
     
     // Encabezado del CSV
     results_csv << "Size_MB,Repetition,N_elements,MergeSort_Time_ms,MergeSort_Disk_Access,"
-                << "QuickSort_Time_ms,QuickSort_Disk_Access\n";
+                << "QuickSort_Time_ms,QuickSort_Disk_Access,RadixSort_Time_ms,RadixSort_Disk_Access,"
+                << "FunnelSort_Time_ms,FunnelSort_Disk_Access\n";
 
     for (size_t i = 0; i < v.size(); ++i){
     // Recorremos el vector de tamaños N → 4,8,…,60
@@ -202,13 +491,17 @@ int main(int argc, char* argv[]){
             // Save results to CSV
             results_csv << mult*stol(argv[1]) << "," << rep << "," << N << "," 
                         << results.merge_time_ms << "," << results.merge_disk_access << ","
-                        << results.quick_time_ms << "," << results.quick_disk_access << "\n";
+                        << results.quick_time_ms << "," << results.quick_disk_access << ","
+                        << results.radix_time_ms << "," << results.radix_disk_access << ","
+                        << results.funnel_time_ms << "," << results.funnel_disk_access << "\n";
                         
             cout << "Archivo " << fn.str() << " procesado.\n";
             
             // 3. Borrar para liberar espacio                                     
             filesystem::remove(fn.str());
             filesystem::remove(fn.str()+".sorted");
+            filesystem::remove(fn.str()+".radix.sorted");
+            filesystem::remove(fn.str()+".funnel.sorted");
             break;
         }
     }
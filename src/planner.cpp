@@ -0,0 +1,401 @@
+//planificador automático de algoritmo, aridad y tamaño de bloque
+//1) calibración corta del dispositivo: escritura y lectura secuencial de un archivo temporal (sin cache de páginas),
+//   lecturas de bloques en posiciones aleatorias (latencia) y un sort en memoria (costo por comparación)
+//2) modelo de costo: con n = N/8 elementos y N/B bloques, ambos algoritmos hacen una pasada de lectura y escritura por nivel
+//   - mergesort: formación de tramos (secuencial) + ceil(log_a(N/M)) pasadas de mezcla, cuyas lecturas se intercalan entre
+//     a tramos (un acceso aleatorio por bloque leído)
+//   - quicksort: ceil(log_a(N/M)) niveles de distribución, cuyas escrituras se intercalan entre las particiones (un acceso
+//     aleatorio por bloque escrito), + la pasada final de las hojas que caben en M (+ un bloque de pivotes por partición)
+//   - CPU: n log2(M/8) comparaciones al ordenar en memoria + n log2(a) por cada pasada de mezcla o nivel de distribución
+//3) se recorren los candidatos a en potencias de 2 y B de 4 KB a 1 MB, con (a + 1) * B <= M, y se elige el de menor tiempo
+//
+//perfil del dispositivo (./main calibrate [directorio]): para cada tamaño de bloque de 4 KB a 16 MB se mide escritura y lectura
+//secuencial y lecturas aleatorias con 1, 4, 16 y 32 lecturas en vuelo (un hilo por lectura concurrente); se recomienda el menor
+//bloque cuya lectura aleatoria alcanza la mitad del máximo secuencial (desde ahí el costo del acceso ya no domina la transferencia)
+//y la menor profundidad de cola que alcanza el 90% del máximo con ese bloque. Los run_* con B_SIZE_arg = 0 usan el bloque
+//recomendado, reducido si hace falta para que quepan a + 1 buffers en M
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include "../headers/planner.hpp"
+#include "../headers/mergesort.hpp"
+#include "../headers/quicksort.hpp"
+
+using namespace std;
+
+// --------------------------------- Calibración ---------------------------------
+
+static double elapsed_ms(chrono::high_resolution_clock::time_point start) {
+    return chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+}
+
+
+static double measure_cpu_ns_per_compare() {
+    // CPU: sort de 1M enteros aleatorios ~ n log2(n) comparaciones
+    const long SORT_ELEMENTS = 1L << 20;
+    mt19937_64 rng(42);
+    vector<int64_t> data(SORT_ELEMENTS);
+    for (int64_t& x : data) x = rng();
+    auto start = chrono::high_resolution_clock::now();
+    sort(data.begin(), data.end());
+    return elapsed_ms(start) * 1e6 / (SORT_ELEMENTS * log2((double)SORT_ELEMENTS));
+}
+
+
+static int openProbeFile(const string& fileName) {
+    int fd = open(fileName.c_str(), O_CREAT | O_TRUNC | O_RDWR, 0644);
+    if (fd < 0) {
+        perror("Error while opening the calibration file");
+        exit(EXIT_FAILURE);
+    }
+    return fd;
+}
+
+
+static double measureSequential(int fd, long file_bytes, long block_size, double& read_mb_s) {
+    /* Escribe file_bytes en bloques de block_size (hasta que quedan en el dispositivo) y los vuelve a leer sin cache de páginas
+    args:
+        fd: descriptor del archivo de prueba
+        file_bytes: bytes a escribir y leer
+        block_size: tamaño de cada escritura y lectura
+        read_mb_s: donde se guarda el ancho de banda de lectura
+    returns:
+        ancho de banda de escritura (MB/s)
+    */
+
+    vector<char> block(block_size, 1);
+    double mb = file_bytes / (1024.0 * 1024.0);
+    auto start = chrono::high_resolution_clock::now();
+    for (long offset = 0; offset < file_bytes; offset += block_size) {
+        ssize_t _ = pwrite(fd, block.data(), block_size, offset);
+    }
+    fsync(fd);
+    double write_mb_s = mb / (elapsed_ms(start) / 1000.0);
+
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    start = chrono::high_resolution_clock::now();
+    for (long offset = 0; offset < file_bytes; offset += block_size) {
+        ssize_t _ = pread(fd, block.data(), block_size, offset);
+    }
+    read_mb_s = mb / (elapsed_ms(start) / 1000.0);
+    return write_mb_s;
+}
+
+
+static double measureRandomReads(int fd, long file_bytes, long block_size, int queue_depth, int num_reads, double& latency_ms) {
+    /* Lecturas de block_size en posiciones aleatorias, con queue_depth lecturas en vuelo (un hilo cada una)
+    args:
+        fd: descriptor del archivo de prueba
+        file_bytes: tamaño del archivo de prueba
+        block_size: tamaño de cada lectura
+        queue_depth: lecturas concurrentes
+        num_reads: total de lecturas
+        latency_ms: donde se guarda la latencia media de una lectura
+    returns:
+        ancho de banda de lectura (MB/s)
+    */
+
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    long num_blocks = max(1L, file_bytes / block_size);
+    vector<double> thread_ms(queue_depth, 0);
+    int reads_per_thread = max(1, num_reads / queue_depth);
+    auto start = chrono::high_resolution_clock::now();
+    vector<thread> threads;
+    for (int t = 0; t < queue_depth; ++t) {
+        threads.emplace_back([&, t]() {
+            mt19937_64 rng(42 + t);
+            uniform_int_distribution<long> block(0, num_blocks - 1);
+            vector<char> buffer(block_size);
+            auto thread_start = chrono::high_resolution_clock::now();
+            for (int i = 0; i < reads_per_thread; ++i) {
+                ssize_t _ = pread(fd, buffer.data(), block_size, block(rng) * block_size);
+            }
+            thread_ms[t] = elapsed_ms(thread_start);
+        });
+    }
+    for (thread& th : threads) th.join();
+    double total_ms = elapsed_ms(start);
+
+    double summed_ms = 0;
+    for (double ms : thread_ms) summed_ms += ms;
+    latency_ms = summed_ms / (reads_per_thread * queue_depth);
+    return (reads_per_thread * queue_depth * (double)block_size / (1024.0 * 1024.0)) / (total_ms / 1000.0);
+}
+
+
+DeviceProfile probe_device(const string& directory, long file_bytes) {
+    /* Barrido del dispositivo: tamaños de bloque de 4 KB a 16 MB y profundidades de cola 1, 4, 16 y 32
+    args:
+        directory: directorio donde quedan los archivos temporales de los ordenamientos
+        file_bytes: tamaño del archivo de prueba (se ajusta a al menos 4 bloques del mayor tamaño)
+    returns:
+        perfil del dispositivo
+    */
+
+    const long MIN_BLOCK = 4096, MAX_BLOCK = 16L * 1024 * 1024;
+    const int QUEUE_DEPTHS[] = {1, 4, 16, 32};
+    file_bytes = max(file_bytes, 4 * MAX_BLOCK);
+
+    DeviceProfile profile = {MIN_BLOCK, 1, {}};
+    string fileName = (filesystem::path(directory) / "calibration.tmp").string();
+    int fd = openProbeFile(fileName);
+
+    for (long block_size = MIN_BLOCK; block_size <= MAX_BLOCK; block_size *= 4) {
+        double seq_read_mb_s;
+        double seq_write_mb_s = measureSequential(fd, file_bytes, block_size, seq_read_mb_s);
+        // Cantidad de lecturas aleatorias: ~64 MB leídos, entre 32 y 1024 lecturas
+        int num_reads = (int)clamp(64L * 1024 * 1024 / block_size, 32L, 1024L);
+        for (int queue_depth : QUEUE_DEPTHS) {
+            double latency_ms;
+            double rand_read_mb_s = measureRandomReads(fd, file_bytes, block_size, queue_depth, num_reads, latency_ms);
+            profile.measurements.push_back({block_size, queue_depth, seq_read_mb_s, seq_write_mb_s, rand_read_mb_s, latency_ms});
+            cout << "B = " << block_size << ", cola = " << queue_depth << ": secuencial " << seq_read_mb_s << " / " << seq_write_mb_s
+                 << " MB/s (lectura / escritura), aleatoria " << rand_read_mb_s << " MB/s, latencia " << latency_ms << " ms" << endl;
+        }
+    }
+    close(fd);
+    filesystem::remove(fileName);
+
+    // Bloque recomendado: el menor cuya lectura aleatoria (una en vuelo, como leen los motores) alcanza la mitad del máximo secuencial
+    double peak_seq_mb_s = 0;
+    for (const BlockMeasurement& m : profile.measurements) peak_seq_mb_s = max(peak_seq_mb_s, m.seq_read_mb_s);
+    profile.recommended_block_size = MAX_BLOCK;
+    for (const BlockMeasurement& m : profile.measurements) {
+        if (m.queue_depth == 1 && m.rand_read_mb_s >= 0.5 * peak_seq_mb_s) {
+            profile.recommended_block_size = m.block_size;
+            break;
+        }
+    }
+    // Profundidad recomendada: la menor que alcanza el 90% del máximo con el bloque recomendado
+    double best_mb_s = 0;
+    for (const BlockMeasurement& m : profile.measurements) {
+        if (m.block_size == profile.recommended_block_size) best_mb_s = max(best_mb_s, m.rand_read_mb_s);
+    }
+    for (const BlockMeasurement& m : profile.measurements) {
+        if (m.block_size == profile.recommended_block_size && m.rand_read_mb_s >= 0.9 * best_mb_s) {
+            profile.recommended_queue_depth = m.queue_depth;
+            break;
+        }
+    }
+    return profile;
+}
+
+
+bool save_device_profile(const DeviceProfile& profile, const string& directory) {
+    /* Guarda el perfil en directory/device_profile.txt: primero los valores recomendados y luego una fila por medición
+    args:
+        profile: perfil a guardar
+        directory: directorio de los archivos temporales
+    returns:
+        true si se pudo escribir
+    */
+
+    ofstream out(filesystem::path(directory) / DEVICE_PROFILE_FILE);
+    if (!out) return false;
+    out << "# perfil del dispositivo (./main calibrate)\n";
+    out << "recommended_block_size " << profile.recommended_block_size << "\n";
+    out << "recommended_queue_depth " << profile.recommended_queue_depth << "\n";
+    out << "# block_size queue_depth seq_read_mb_s seq_write_mb_s rand_read_mb_s rand_latency_ms\n";
+    for (const BlockMeasurement& m : profile.measurements) {
+        out << m.block_size << " " << m.queue_depth << " " << m.seq_read_mb_s << " " << m.seq_write_mb_s << " "
+            << m.rand_read_mb_s << " " << m.rand_latency_ms << "\n";
+    }
+    return (bool)out;
+}
+
+
+bool load_device_profile(const string& directory, DeviceProfile& profile) {
+    /* Lee el perfil guardado por save_device_profile
+    args:
+        directory: directorio de los archivos temporales
+        profile: donde se guarda el perfil leído
+    returns:
+        false si no hay perfil (o no tiene bloque recomendado)
+    */
+
+    ifstream in(filesystem::path(directory) / DEVICE_PROFILE_FILE);
+    if (!in) return false;
+    profile = {0, 1, {}};
+    string line;
+    while (getline(in, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        istringstream fields(line);
+        if (isdigit((unsigned char)line[0])) {
+            BlockMeasurement m;
+            if (fields >> m.block_size >> m.queue_depth >> m.seq_read_mb_s >> m.seq_write_mb_s >> m.rand_read_mb_s >> m.rand_latency_ms) {
+                profile.measurements.push_back(m);
+            }
+        } else {
+            string name;
+            fields >> name;
+            if (name == "recommended_block_size") fields >> profile.recommended_block_size;
+            else if (name == "recommended_queue_depth") fields >> profile.recommended_queue_depth;
+        }
+    }
+    return profile.recommended_block_size > 0;
+}
+
+
+long profile_block_size(long M_SIZE, int a, const string& directory) {
+    /* Tamaño de bloque del perfil, reducido a la mitad mientras no quepan a + 1 buffers de bloque en M (mínimo 4 KB)
+    args:
+        M_SIZE: memoria principal en bytes
+        a: aridad / particiones
+        directory: directorio con el perfil
+    returns:
+        tamaño de bloque en bytes (4096 si no hay perfil)
+    */
+
+    DeviceProfile profile;
+    if (!load_device_profile(directory, profile)) return 4096;
+    long B = profile.recommended_block_size;
+    while (B > 4096 && (long)(a + 1) * B > M_SIZE) B /= 2;
+    return B;
+}
+
+
+DeviceCalibration calibrate_device(const string& directory) {
+    /* Mide ancho de banda secuencial, latencia de acceso aleatorio y costo de comparación; si hay un perfil guardado
+    en directory, las mediciones de E/S se toman de él
+    args:
+        directory: directorio donde se crea el archivo temporal (el mismo donde quedan los archivos a ordenar)
+    returns:
+        calibración del dispositivo
+    */
+
+    DeviceCalibration device = {0, 0, 0, measure_cpu_ns_per_compare()};
+
+    DeviceProfile profile;
+    if (load_device_profile(directory, profile) && !profile.measurements.empty()) {
+        // Secuencial: el mejor bloque medido; latencia: bloques de 4 KB con una lectura en vuelo
+        for (const BlockMeasurement& m : profile.measurements) {
+            device.seq_read_mb_s = max(device.seq_read_mb_s, m.seq_read_mb_s);
+            device.seq_write_mb_s = max(device.seq_write_mb_s, m.seq_write_mb_s);
+            if (m.queue_depth == 1 && m.block_size == profile.measurements.front().block_size) {
+                device.access_latency_ms = m.rand_latency_ms;
+            }
+        }
+        return device;
+    }
+
+    // Medición corta: 32 MB secuenciales en bloques de 1 MB y 256 lecturas aleatorias de 4 KB
+    const long CALIBRATION_BYTES = 32L * 1024 * 1024;
+    string fileName = (filesystem::path(directory) / "calibration.tmp").string();
+    int fd = openProbeFile(fileName);
+    device.seq_write_mb_s = measureSequential(fd, CALIBRATION_BYTES, 1024L * 1024, device.seq_read_mb_s);
+    measureRandomReads(fd, CALIBRATION_BYTES, 4096, 1, 256, device.access_latency_ms);
+    close(fd);
+    filesystem::remove(fileName);
+    return device;
+}
+
+// --------------------------------- Modelo de costo ---------------------------------
+
+double predict_time_ms(SortPlan::Algorithm algorithm, long long N_BYTES, long M_SIZE, int a, long B_SIZE,
+                       const DeviceCalibration& device, long long& disk_access) {
+    /* Tiempo y accesos a disco predichos para ordenar N_BYTES con memoria M_SIZE, aridad a y bloque B_SIZE
+    args:
+        algorithm: MERGESORT o QUICKSORT
+        N_BYTES: tamaño del archivo en bytes
+        M_SIZE: memoria principal en bytes
+        a: aridad / particiones
+        B_SIZE: tamaño del bloque en bytes
+        device: calibración del dispositivo
+        disk_access: donde se guardan los accesos a disco predichos
+    returns:
+        tiempo predicho en ms
+    */
+
+    double n = N_BYTES / (double)sizeof(int64_t);
+    double blocks = ceil(N_BYTES / (double)B_SIZE);
+    double read_ms = B_SIZE / (device.seq_read_mb_s * 1024.0 * 1024.0) * 1000.0;    // transferir un bloque
+    double write_ms = B_SIZE / (device.seq_write_mb_s * 1024.0 * 1024.0) * 1000.0;
+    double in_memory_compares = n * log2(max(2.0, min(n, M_SIZE / (double)sizeof(int64_t))));
+
+    // Pasadas de mezcla del mergesort / niveles de distribución del quicksort: ceil(log_a(N/M))
+    int levels = 0;
+    for (double size = N_BYTES; size > M_SIZE; size /= a) levels++;
+
+    double time_ms;
+    if (algorithm == SortPlan::MERGESORT) {
+        disk_access = (long long)(2 * blocks * (1 + levels));
+        time_ms = blocks * (read_ms + write_ms)                                              // formación de tramos
+                + levels * blocks * (device.access_latency_ms + read_ms + write_ms)          // lecturas intercaladas entre a tramos
+                + (in_memory_compares + levels * n * log2(a)) * device.cpu_ns_per_compare / 1e6;
+    } else {
+        double partitions = 0;  // particiones que se distribuyen (un bloque de pivotes cada una)
+        for (int level = 0; level < levels; ++level) partitions += pow(a, level);
+        disk_access = (long long)(2 * blocks * (1 + levels) + partitions);
+        time_ms = levels * blocks * (device.access_latency_ms + read_ms + write_ms)          // escrituras intercaladas entre particiones
+                + partitions * (device.access_latency_ms + read_ms)                          // bloque de pivotes
+                + blocks * (read_ms + write_ms)                                              // hojas que caben en M
+                + (in_memory_compares + levels * n * log2(a)) * device.cpu_ns_per_compare / 1e6;
+    }
+    return time_ms;
+}
+
+
+SortPlan plan_sort(long long N_BYTES, long M_SIZE, const DeviceCalibration& device) {
+    /* Elige el plan de menor tiempo predicho
+    args:
+        N_BYTES: tamaño del archivo en bytes
+        M_SIZE: memoria principal en bytes
+        device: calibración del dispositivo
+    returns:
+        plan elegido (con su predicción)
+    */
+
+    SortPlan best = {SortPlan::MERGESORT, 2, 4096, M_SIZE, 3 * 4096, 0, -1};
+    for (SortPlan::Algorithm algorithm : {SortPlan::MERGESORT, SortPlan::QUICKSORT}) {
+        for (long B = 4096; B <= 1024L * 1024; B *= 2) {
+            for (int a = 2; (long)(a + 1) * B <= M_SIZE && a <= 1024; a *= 2) {
+                long long disk_access;
+                double time_ms = predict_time_ms(algorithm, N_BYTES, M_SIZE, a, B, device, disk_access);
+                if (best.predicted_time_ms < 0 || time_ms < best.predicted_time_ms) {
+                    best = {algorithm, a, B, M_SIZE, (a + 1) * B, disk_access, time_ms};
+                }
+            }
+        }
+    }
+    if (best.predicted_time_ms < 0) {
+        best.predicted_time_ms = predict_time_ms(best.algorithm, N_BYTES, M_SIZE, best.a, best.B_SIZE, device, best.predicted_disk_access);
+    }
+    return best;
+}
+
+
+PlanResult run_plan(const string& inputFile, long long N_BYTES, const SortPlan& plan) {
+    /* Ejecuta el plan y mide tiempo y accesos a disco
+    args:
+        inputFile: nombre del archivo de entrada
+        N_BYTES: tamaño del archivo en bytes
+        plan: plan a ejecutar
+    returns:
+        resultado medido
+    */
+
+    auto start = chrono::high_resolution_clock::now();
+    long long disk_access;
+    if (plan.algorithm == SortPlan::MERGESORT) {
+        disk_access = run_mergesort(inputFile, N_BYTES, plan.a, plan.B_SIZE, plan.M_SIZE);
+    } else {
+        disk_access = run_quicksort(inputFile, N_BYTES / sizeof(int64_t), plan.a, plan.B_SIZE, plan.M_SIZE);
+    }
+    return {(long long)elapsed_ms(start), disk_access};
+}
+
+
+const char* algorithm_name(SortPlan::Algorithm algorithm) {
+    return algorithm == SortPlan::MERGESORT ? "MergeSort" : "QuickSort";
+}
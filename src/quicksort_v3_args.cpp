@@ -19,9 +19,9 @@
 // 2) Se seleccionan aleatoriamente a-1 pivotes dentro del bloque seleccionado en el paso anterior (ya son elementos al azar, por lo que son buenos candidatos como pivotes)
 // 2.1) en un buffer ordeno gratis los pivotes seleccionados en el paso anterior (es gratis, ya que en general a es menor que B_SIZE = 4096)
 // 3) Uso secuencialmente los pivotes ordenados para definir en que (a-1 archivos temporales usados como buffers) se almacenan los elementos menores, entre medio y mayores a los pivotes seleccionados en el paso 2 leyendo el input N por bloques de tamaño B_SIZE
-// 4) Se llama recursivamente a quicksort para cada uno de los buffers generados en el paso 3
-// 5) Finalmente se unen los buffers generados de acuerdo a los pivotes, ejemplo:
-// el buffer de menores a pivote 1, pivote 1, el buffer de elementos entre pivote 1 y 2, pivote 2 y así sucesivamente
+// 4) Cada buffer generado en el paso 3 que no cabe en memoria se agrega a una cola de tareas (en vez de llamar recursivamente a quicksort)
+// 5) Cada partición se escribe directo en su posición del archivo final, que se conoce sumando los tamaños de las anteriores, ejemplo:
+// el buffer de menores a pivote 1, los iguales a pivote 1, el buffer de elementos entre pivote 1 y 2, los iguales a pivote 2 y así sucesivamente
 //retorna el array ordenado
 
 #include <iostream>
@@ -31,43 +31,52 @@
 #include <ctime>
 #include <algorithm>
 #include <filesystem>
+#include <thread>
+#include <functional>
+#include "../headers/quicksort.hpp"
+#include "../headers/planner.hpp"
+#include "../headers/memory_governor.hpp"
+#include "../headers/sort_context.hpp"
 
 using namespace std;
 
 // --------------------------------- Variables globales ---------------------------------
-long B_SIZE; // tamaño del bloque en bytes
-long M_SIZE; //tamaño de memoria principal (50 MB)
-long long disk_access = 0; // contador de accesos al disco
+// B, M, el contador de accesos y el generador aleatorio viven en el SortContext de cada ordenamiento
+QuicksortOptions quicksort_options; // opciones con las que parten los contextos nuevos (set_quicksort_options)
+
+// Buffers de elementos: se piden al gobernador de memoria (headers/memory_governor.hpp)
+using Buffer = ArenaVector<int64_t>;
 
 // --------------------------------- Funciones de I/O por bloque ---------------------------------
 
 
-size_t readBlock(FILE* file, long blockOffset, vector<int64_t>& buffer, bool first_seek) {
+size_t readBlock(SortContext& context, FILE* file, long blockOffset, Buffer& buffer) {
     /* Lee un bloque de tamaño B_SIZE desde el archivo en el offset dado y lo almacena en el buffer 
     args:
+        context: contexto del ordenamiento
         file: puntero al archivo desde el cual se leerá
         blockOffset: offset del bloque a leer
         buffer: vector donde se almacenarán los datos leídos
-        first_seek: indica si es la primera lectura (para contar accesos a disco)
     returns:
         bytesRead: número de bytes leídos // en verdad no se usan luego esos bytes pero el compilador se quejaba
     */
 
-    size_t numElements = B_SIZE / sizeof(int64_t);  // Número de elementos en un bloque
+    size_t numElements = context.B_SIZE / sizeof(int64_t);  // Número de elementos en un bloque
     buffer.resize(numElements);
-    fseek(file, blockOffset * B_SIZE, SEEK_SET);  // Mover el puntero del archivo
+    fseek(file, blockOffset * context.B_SIZE, SEEK_SET);  // Mover el puntero del archivo
     size_t bytesRead = fread(buffer.data(), sizeof(int64_t), numElements, file);
-    if (bytesRead > 0 and first_seek){
-        disk_access++;  // Contar acceso a disco
+    if (bytesRead > 0) {
+        context.disk_access++;  // Contar acceso a disco (en todos los niveles, como el mergesort y el radix)
     }
 
     return bytesRead;
 }
 
 
-void flushBufferToFile(const string& filename, vector<int64_t>& buffer) {
+void flushBufferToFile(SortContext& context, const string& filename, Buffer& buffer) {
     /* Volcar (flush) el contenido del buffer a un archivo en modo append 
     args:
+        context: contexto del ordenamiento
         filename: nombre del archivo donde se volcará el buffer
         buffer: vector que contiene los datos a escribir
     returns:
@@ -78,15 +87,229 @@ void flushBufferToFile(const string& filename, vector<int64_t>& buffer) {
     FILE* outFile = fopen(filename.c_str(), "ab");
     fwrite(buffer.data(), sizeof(int64_t), buffer.size(), outFile);
     fclose(outFile);
+    context.disk_access += (buffer.size() * sizeof(int64_t) + context.B_SIZE - 1) / context.B_SIZE;
     buffer.clear();  // Limpiar buffer después de escribir
 }
 
 
+void flushBufferToPartition(SortContext& context, FILE*& handle, const string& filename, Buffer& buffer, bool keepOpen) {
+    /* Vuelca el buffer de una partición a su archivo temporal, dejando el descriptor abierto si se permite
+    args:
+        context: contexto del ordenamiento
+        handle: descriptor de la partición (se abre la primera vez)
+        filename: nombre del archivo temporal de la partición
+        buffer: vector que contiene los datos a escribir
+        keepOpen: si es false se abre y cierra el archivo en cada volcado (modo append)
+    returns:
+        void
+    */
+
+    if (!keepOpen) {
+        flushBufferToFile(context, filename, buffer);
+        return;
+    }
+    if (buffer.empty()) return;
+    if (!handle) handle = fopen(filename.c_str(), "wb");
+    fwrite(buffer.data(), sizeof(int64_t), buffer.size(), handle);
+    context.disk_access += (buffer.size() * sizeof(int64_t) + context.B_SIZE - 1) / context.B_SIZE;
+    buffer.clear();
+}
+
+
+void appendFileToBuffer(SortContext& context, const string& filename, Buffer& buffer, long numElements) {
+    /* Lee un archivo temporal completo y agrega sus elementos al final del buffer
+    args:
+        context: contexto del ordenamiento
+        filename: nombre del archivo a leer
+        buffer: vector al que se agregarán los datos leídos
+        numElements: número de elementos que contiene el archivo
+    returns:
+        void
+    */
+
+    size_t offset = buffer.size();
+    buffer.resize(offset + numElements);
+    FILE* inFile = fopen(filename.c_str(), "rb");
+    size_t _ = fread(buffer.data() + offset, sizeof(int64_t), numElements, inFile);
+    fclose(inFile);
+    context.disk_access += (numElements * sizeof(int64_t) + context.B_SIZE - 1) / context.B_SIZE;
+}
+
+
+void writeBlocksToFile(SortContext& context, FILE* file, long elementOffset, const Buffer& buffer) {
+    /* Escribe el buffer completo en el archivo de salida (ya abierto) a partir de la posición dada, por bloques de tamaño B_SIZE
+    args:
+        context: contexto del ordenamiento
+        file: puntero al archivo de salida
+        elementOffset: posición (en elementos) donde empieza la escritura
+        buffer: vector con los datos a escribir
+    returns:
+        void
+    */
+
+    size_t elemsPerBlock = context.B_SIZE / sizeof(int64_t);
+    fseek(file, elementOffset * sizeof(int64_t), SEEK_SET);
+    for (size_t written = 0; written < buffer.size(); written += elemsPerBlock) {
+        size_t numElements = min(elemsPerBlock, buffer.size() - written);
+        fwrite(buffer.data() + written, sizeof(int64_t), numElements, file);
+        ++context.disk_access;  // Contar acceso a disco (escritura en la salida final)
+        context.outputWritten(elementOffset + written, buffer.data() + written, numElements);
+    }
+}
+
+
+void sortAndWritePack(SortContext& context, FILE* file, long cursor, Buffer& packBuffer) {
+    /* Ordena en memoria un paquete de particiones hermanas, lo escribe al archivo de salida y lo vacía
+    args:
+        context: contexto del ordenamiento
+        file: puntero al archivo de salida
+        cursor: posición de salida justo después del paquete (el paquete termina ahí)
+        packBuffer: vector con los elementos del paquete
+    returns:
+        void
+    */
+
+    if (packBuffer.empty()) return;
+    sort(packBuffer.begin(), packBuffer.end());
+    writeBlocksToFile(context, file, cursor - (long)packBuffer.size(), packBuffer);
+    packBuffer.clear();
+}
+
+
+void writeRepeatedToFile(SortContext& context, FILE* file, long elementOffset, int64_t value, long count) {
+    /* Escribe count copias de value en el archivo a partir de la posición dada, por bloques de tamaño B_SIZE (bucket de igualdad)
+    args:
+        context: contexto del ordenamiento
+        file: puntero al archivo de salida
+        elementOffset: posición (en elementos) donde empieza la escritura
+        value: valor a repetir
+        count: cantidad de copias
+    returns:
+        void
+    */
+
+    size_t elemsPerBlock = context.B_SIZE / sizeof(int64_t);
+    Buffer repeated(min((long)elemsPerBlock, count), value);
+    fseek(file, elementOffset * sizeof(int64_t), SEEK_SET);
+    for (long written = 0; written < count; written += repeated.size()) {
+        size_t numElements = min((long)repeated.size(), count - written);
+        fwrite(repeated.data(), sizeof(int64_t), numElements, file);
+        ++context.disk_access;  // Contar acceso a disco (escritura en la salida final)
+        context.outputWritten(elementOffset + written, repeated.data(), numElements);
+    }
+}
+
+
+// --------------------------------- Cola de trabajo del Quicksort Externo ---------------------------------
+
+// Tarea pendiente: una partición (archivo temporal) que debe quedar ordenada en [outputOffset, outputOffset + N_SIZE) de la salida
+struct QuicksortTask {
+    long id;               // identificador, define el nombre del archivo temporal (id 0 = archivo de entrada)
+    long N_SIZE;           // número de elementos de la partición
+    long outputOffset;     // posición (en elementos) de la partición en el archivo final
+    int equality_buckets;  // 1 si la partición se procesa con buckets de igualdad
+};
+
+// Cola de tareas con tope en memoria: las tareas que no caben se vuelcan a un archivo y se recuperan cuando la cola se vacía
+struct QuicksortQueue {
+    vector<QuicksortTask> tasks;  // tareas en memoria
+    string spillFile;             // archivo donde se vuelcan las tareas sobrantes
+    long spilledTasks = 0;        // tareas escritas en spillFile
+    long reloadedTasks = 0;       // tareas de spillFile ya recuperadas
+    long liveTempFiles = 0;       // archivos temporales de particiones que existen en disco
+    long nextTaskId = 1;          // siguiente id libre para los archivos temporales
+};
+
+
+string taskFileName(SortContext& context, const string& inputFile, long id) {
+    /* Nombre del archivo temporal de una tarea (un contador evita nombres anidados que crecen con la profundidad; el
+    prefijo del contexto evita choques con otros ordenamientos del mismo directorio)
+    args:
+        context: contexto del ordenamiento
+        inputFile: nombre del archivo de entrada del ordenamiento
+        id: identificador de la tarea
+    returns:
+        nombre del archivo de la tarea
+    */
+
+    if (id == 0) return inputFile;
+    return context.tempName("part" + to_string(id));
+}
+
+
+void pushTask(SortContext& context, QuicksortQueue& queue, const QuicksortTask& task) {
+    /* Agrega una tarea a la cola, volcándola al archivo de tareas si la cola en memoria está llena
+    args:
+        context: contexto del ordenamiento
+        queue: cola de tareas
+        task: tarea a agregar
+    returns:
+        void
+    */
+
+    if ((long)queue.tasks.size() < context.quicksort_options.max_tasks_in_memory) {
+        queue.tasks.push_back(task);
+        return;
+    }
+    FILE* spill = fopen(queue.spillFile.c_str(), "ab");
+    fwrite(&task, sizeof(QuicksortTask), 1, spill);
+    fclose(spill);
+    context.disk_access++;
+    queue.spilledTasks++;
+}
+
+
+bool popTask(SortContext& context, QuicksortQueue& queue, QuicksortTask& task) {
+    /* Saca la siguiente tarea según la política de la cola (profundidad primero o más grande primero).
+    Si hay demasiados archivos temporales vivos se elige la tarea más pequeña, que es la que antes los libera
+    args:
+        context: contexto del ordenamiento
+        queue: cola de tareas
+        task: tarea extraída
+    returns:
+        false si no quedan tareas
+    */
+
+    // Recuperar tareas volcadas cuando la cola en memoria se vacía
+    if (queue.tasks.empty() && queue.reloadedTasks < queue.spilledTasks) {
+        long toReload = min((long)context.quicksort_options.max_tasks_in_memory, queue.spilledTasks - queue.reloadedTasks);
+        queue.tasks.resize(toReload);
+        FILE* spill = fopen(queue.spillFile.c_str(), "rb");
+        fseek(spill, queue.reloadedTasks * sizeof(QuicksortTask), SEEK_SET);
+        size_t _ = fread(queue.tasks.data(), sizeof(QuicksortTask), toReload, spill);
+        fclose(spill);
+        context.disk_access += (toReload * sizeof(QuicksortTask) + context.B_SIZE - 1) / context.B_SIZE;
+        queue.reloadedTasks += toReload;
+        if (queue.reloadedTasks == queue.spilledTasks) {
+            filesystem::remove(queue.spillFile);
+            queue.spilledTasks = queue.reloadedTasks = 0;
+        }
+    }
+    if (queue.tasks.empty()) return false;
+
+    size_t chosen = queue.tasks.size() - 1;  // profundidad primero: la última tarea agregada
+    if (queue.liveTempFiles > context.quicksort_options.max_live_temp_files) {
+        for (size_t i = 0; i < queue.tasks.size(); ++i) {
+            if (queue.tasks[i].N_SIZE < queue.tasks[chosen].N_SIZE) chosen = i;
+        }
+    } else if (context.quicksort_options.queue_order == QuicksortOptions::LARGEST_FIRST) {
+        for (size_t i = 0; i < queue.tasks.size(); ++i) {
+            if (queue.tasks[i].N_SIZE > queue.tasks[chosen].N_SIZE) chosen = i;
+        }
+    }
+    task = queue.tasks[chosen];
+    queue.tasks[chosen] = queue.tasks.back();
+    queue.tasks.pop_back();
+    return true;
+}
+
+
 // --------------------------------- Funciones del algoritmo Quicksort Externo ---------------------------------
 
-void selectPivots(vector<int64_t>& block, int numPivots) {
+void selectPivots(SortContext& context, Buffer& block, int numPivots) {
     /* Selecciona pivotes aleatorios dentro de un bloque y los coloca al inicio de este 
     args:
+        context: contexto del ordenamiento
         block: bloque de datos del que se seleccionarán los pivotes
         numPivots: número de pivotes a seleccionar
     returns: 
@@ -99,139 +322,404 @@ void selectPivots(vector<int64_t>& block, int numPivots) {
         return;
     }
 
-    srand(time(0));
     for (int i = 0; i < numPivots - 1; ++i) {
-        int randIndex = rand() % block.size();
+        long randIndex = context.random(block.size());
         swap(block[i], block[randIndex]);  // Intercambiar para agrupar los pivotes al inicio
     }
 }
 
 
-void externalQuicksort(const string& fileName, long N_SIZE, int a, bool first_run) {
-    /* Función principal de Quicksort Externo de acuerdo al algoritmo descrito
+void classifyStripe(const int64_t* data, size_t count, const Buffer& pivots, bool equality_buckets,
+                    vector<Buffer>& buckets, vector<long>& equalCounts) {
+    /* Clasifica una franja de elementos según los pivotes, en buckets propios del hilo que la procesa
     args:
-        fileName: nombre del archivo con los datos a ordenar
-        N_SIZE: número total de elementos en el archivo
+        data: puntero al inicio de la franja
+        count: número de elementos de la franja
+        pivots: pivotes ordenados y sin repetidos
+        equality_buckets: si es true, los elementos iguales a un pivote solo se cuentan
+        buckets: un vector por partición donde se agregan los elementos
+        equalCounts: contador de iguales por pivote
+    returns:
+        void
+    */
+
+    for (size_t i = 0; i < count; ++i) {
+        int64_t value = data[i];
+        // Primera partición cuyo pivote es mayor que el valor (value < pivots[p])
+        int partitionIndex = upper_bound(pivots.begin(), pivots.end(), value) - pivots.begin();
+        if (equality_buckets && partitionIndex > 0 && pivots[partitionIndex - 1] == value) {
+            equalCounts[partitionIndex - 1]++;
+            continue;
+        }
+        buckets[partitionIndex].push_back(value); // agregar el elemento al bucket de la partición correspondiente
+    }
+}
+
+
+void quicksortLevel(SortContext& context, const string& inputFile, const QuicksortTask& task, int a, FILE* output, QuicksortQueue& queue) {
+    /* Procesa una tarea del Quicksort Externo: ordena la partición en memoria si cabe en M, o la particiona
+    según a-1 pivotes y agrega a la cola las particiones que aún no caben en memoria
+    args:
+        context: contexto del ordenamiento
+        inputFile: nombre del archivo de entrada del ordenamiento (base de los nombres temporales)
+        task: tarea a procesar
         a: número de particiones que se crearán
-        firts_run: indica si es la primera ejecución (para contar accesos a disco)
+        output: archivo de salida final (abierto en modo lectura/escritura)
+        queue: cola de tareas, recibe las nuevas particiones
     returns:
         void
     */
 
+    string fileName = taskFileName(context, inputFile, task.id);
+    long N_SIZE = task.N_SIZE;
+    bool equality_buckets = task.equality_buckets;
+
+    // Elementos que caben en memoria: M, o lo que quede en la arena si el gobernador adapta
+    long M_elements = context.M_SIZE / sizeof(int64_t);
+    if (memory_governor.adapts()) M_elements = max(1L, min(M_elements, (long)(memory_governor.available() / sizeof(int64_t)) - 1));
+
     // Caso base: Si los datos caben en la memoria principal, ordenar directamente en memoria
-    if (N_SIZE * sizeof(int64_t) <= M_SIZE) {
-        vector<int64_t> buffer(N_SIZE);
+    if (N_SIZE <= M_elements) {
+        Buffer buffer;
         
         // Leer el archivo completo en memoria y ordenarlo gratis
-        FILE* file = fopen(fileName.c_str(), "rb+");
-        size_t _ = fread(buffer.data(), sizeof(int64_t), N_SIZE, file);
+        appendFileToBuffer(context, fileName, buffer, N_SIZE);
         sort(buffer.begin(), buffer.end());
+        if (task.id != 0) {
+            filesystem::remove(fileName);
+            queue.liveTempFiles--;
+        }
 
-        // Escribir el archivo ordenado de vuelta
-        fseek(file, 0, SEEK_SET);
-        fwrite(buffer.data(), sizeof(int64_t), N_SIZE, file);
-        fclose(file);
+        // Escribir la partición ordenada en su posición del archivo final
+        writeBlocksToFile(context, output, task.outputOffset, buffer);
         return;
     }
 
     // 1) Leer un bloque aleatorio para seleccionar pivotes
     FILE* file = fopen(fileName.c_str(), "rb");
-    long blockCount = (N_SIZE * sizeof(int64_t) + B_SIZE - 1) / B_SIZE;
+    long blockCount = (N_SIZE * sizeof(int64_t) + context.B_SIZE - 1) / context.B_SIZE;
 
     // Leer un bloque aleatorio
-    vector<int64_t> block;
-    long randBlock = rand() % blockCount;
-    size_t bytesRead = readBlock(file, randBlock, block, first_run);
+    Buffer block;
+    long randBlock = context.random(blockCount);
+    size_t bytesRead = readBlock(context, file, randBlock, block);
 
     if (bytesRead == 0 || block.empty()) {
         cerr << "Error: Failed to read block or block is empty" << endl;
         fclose(file);
         return;
     }
+    block.resize(bytesRead);  // el último bloque puede venir incompleto, los pivotes deben salir de datos reales
     
-    // 2) Seleccionar pivotes aleatorios dentro del bloque y ordenarlos
-    selectPivots(block, a);
-    sort(block.begin(), block.begin() + (a - 1));  // esto es gratis ya que a<B_SIZE
+    // 2) Seleccionar pivotes aleatorios dentro del bloque, ordenarlos y quitar los repetidos
+    // (con pocos valores distintos varios pivotes salen iguales y generarían particiones vacías)
+    int numPivots = min((long)a - 1, (long)block.size());
+    if (memory_governor.adapts()) {
+        // Con ADAPT, menos particiones si sus buffers de un bloque, el bloque de lectura y un lote mínimo no caben en la arena
+        long fittingPartitions = (long)memory_governor.available() / context.B_SIZE - 4;
+        numPivots = (int)max(1L, min((long)numPivots, fittingPartitions - 1));
+    }
+    selectPivots(context, block, numPivots + 1);
+    sort(block.begin(), block.begin() + numPivots);  // esto es gratis ya que a<B_SIZE
+    numPivots = unique(block.begin(), block.begin() + numPivots) - block.begin();
+    Buffer pivots(block.begin(), block.begin() + numPivots);
+    int numPartitions = numPivots + 1;
+    Buffer().swap(block);
     
     fclose(file);
 
-    // Declarar los arreglos a usar como archivos temporales para las particiones
-    vector<string> partitionFiles(a);
-    vector<vector<int64_t>> partitionBuffers(a);
+    // Declarar los arreglos a usar como archivos temporales para las particiones.
+    // Cada partición recibe un id nuevo; se reservan todos de una vez para que los nombres no choquen
+    long firstChildId = queue.nextTaskId;
+    queue.nextTaskId += numPartitions;
+    vector<string> partitionFiles(numPartitions);
+    vector<Buffer> partitionBuffers(numPartitions);
+    for (Buffer& buffer : partitionBuffers) buffer.reserve(context.B_SIZE / sizeof(int64_t));  // un bloque por partición, sin crecer de más
+    vector<long> equalCounts(numPivots, 0); // buckets de igualdad: basta contar, todos sus elementos valen lo mismo que el pivote
+
+    // Los descriptores de las particiones se mantienen abiertos solo si no superan el máximo permitido
+    bool keepOpen = numPartitions <= context.quicksort_options.max_open_files;
+    vector<FILE*> partitionHandles(numPartitions, nullptr);
 
     // Caso borde -> Eliminar archivos temporales si ya existían
-    for (int i = 0; i < a; ++i) {
-        partitionFiles[i] = fileName + ".part" + to_string(i);
+    for (int i = 0; i < numPartitions; ++i) {
+        partitionFiles[i] = taskFileName(context, inputFile, firstChildId + i);
         filesystem::remove(partitionFiles[i]);
     }
 
-    // 3) Leer el archivo y particionar los elementos en función de los pivotes
+    // 3) Leer el archivo y particionar los elementos en función de los pivotes.
+    // Se lee un lote de bloques, cada hilo clasifica una franja contigua del lote en sus buckets locales
+    // y luego se agregan a las particiones en orden de franja (la salida es la misma que con un solo hilo)
     file = fopen(fileName.c_str(), "rb");
-    vector<int64_t> currentBlock;
-    size_t elemsPerBlock = B_SIZE / sizeof(int64_t);
+    Buffer currentBlock;
+    size_t elemsPerBlock = context.B_SIZE / sizeof(int64_t);
     long totalReadElements = 0;
     long blockIndex = 0;
+    vector<long> partitionSizes(numPartitions, 0); // elementos por partición, para no depender de file_size
+    vector<bool> spilled(numPartitions, false);    // true si la partición ya tiene datos en su archivo temporal
+
+    int numThreads = max(1, context.quicksort_options.classification_threads);
+    long batchBlocks = (long)numThreads * context.quicksort_options.blocks_per_stripe;
+    if (memory_governor.currentPolicy() != MemoryGovernor::UNLIMITED) {
+        // Con presupuesto (ADAPT o FAIL_FAST) el lote sale de M y no de blocks_per_stripe: el lote y los buckets locales deben
+        // caber en la arena, y un bucket que recibe todo el lote llega a tener vivas su capacidad anterior y la nueva
+        // (el doble) al crecer, hasta unas 4 veces el lote además del lote mismo
+        long fitting = (long)memory_governor.available() / (5 * context.B_SIZE) - 1;
+        batchBlocks = max(1L, min(batchBlocks, fitting));
+    }
+    Buffer batch;
+    vector<vector<Buffer>> localBuckets(numThreads, vector<Buffer>(numPartitions));
+    vector<vector<long>> localEqualCounts(numThreads, vector<long>(numPivots, 0));
 
     while (totalReadElements < N_SIZE) {
         // Debemos leer el archivo en bloques de tamaño B_SIZE para ordenar los elementos de acuerdo a los pivotes en sub arreglos
         // De lo contrario, si leemos solo el bloque seleccionado, no tendremos en cuenta el resto de los elementos
-        size_t numElementsRead = readBlock(file, blockIndex++, currentBlock, first_run);
-
-        // Distribuir los elementos en las particiones correspondientes
-        for (size_t i = 0; i < numElementsRead; ++i) {
-            int64_t value = currentBlock[i];
-            int partitionIndex = a - 1;
-            for (int p = 0; p < a - 1; ++p) {
-                if (value < block[p]) { partitionIndex = p; break; }
+        batch.clear();
+        for (long b = 0; b < batchBlocks && totalReadElements < N_SIZE; ++b) {
+            size_t numElementsRead = readBlock(context, file, blockIndex++, currentBlock);
+            numElementsRead = min((long)numElementsRead, N_SIZE - totalReadElements);
+            if (numElementsRead == 0) break;  // el archivo tiene menos elementos de los indicados
+            batch.insert(batch.end(), currentBlock.begin(), currentBlock.begin() + numElementsRead);
+            totalReadElements += numElementsRead;
+        }
+        if (batch.empty()) break;
+
+        // Clasificar las franjas del lote (con un solo hilo no se lanzan hilos)
+        size_t stripeSize = (batch.size() + numThreads - 1) / numThreads;
+        if (numThreads == 1) {
+            classifyStripe(batch.data(), batch.size(), pivots, equality_buckets, localBuckets[0], localEqualCounts[0]);
+        } else {
+            vector<thread> workers;
+            for (int t = 0; t < numThreads; ++t) {
+                size_t begin = min(batch.size(), t * stripeSize);
+                size_t count = min(batch.size(), begin + stripeSize) - begin;
+                workers.emplace_back(classifyStripe, batch.data() + begin, count, cref(pivots), equality_buckets,
+                                     ref(localBuckets[t]), ref(localEqualCounts[t]));
             }
-            partitionBuffers[partitionIndex].push_back(value); // agregar el elemento al buffer de la partición correspondiente
+            for (thread& worker : workers) worker.join();
+        }
 
-            // Si el buffer de la partición alcanzó el tamaño de bloque, volcarlo
-            if (partitionBuffers[partitionIndex].size() == elemsPerBlock) {
-                flushBufferToFile(partitionFiles[partitionIndex], partitionBuffers[partitionIndex]);
+        // Escritor: agregar los buckets locales a las particiones compartidas, volcando cada bloque completo
+        for (int t = 0; t < numThreads; ++t) {
+            for (int p = 0; p < numPartitions; ++p) {
+                Buffer& local = localBuckets[t][p];
+                size_t appended = 0;
+                while (appended < local.size()) {
+                    size_t toAppend = min(elemsPerBlock - partitionBuffers[p].size(), local.size() - appended);
+                    partitionBuffers[p].insert(partitionBuffers[p].end(), local.begin() + appended, local.begin() + appended + toAppend);
+                    appended += toAppend;
+
+                    // Si el buffer de la partición alcanzó el tamaño de bloque, volcarlo
+                    if (partitionBuffers[p].size() == elemsPerBlock) {
+                        flushBufferToPartition(context, partitionHandles[p], partitionFiles[p], partitionBuffers[p], keepOpen);
+                        spilled[p] = true;
+                    }
+                }
+                partitionSizes[p] += local.size();
+                // Con presupuesto se devuelve la capacidad: si no, cada bucket local retiene su máximo entre lotes
+                if (memory_governor.currentPolicy() != MemoryGovernor::UNLIMITED) Buffer().swap(local);
+                else local.clear();
+            }
+            for (int p = 0; p < numPivots; ++p) {
+                equalCounts[p] += localEqualCounts[t][p];
+                localEqualCounts[t][p] = 0;
             }
         }
-        totalReadElements += numElementsRead;
     }
     fclose(file);
+    // Los buffers de la distribución ya no se usan: se liberan antes de armar los paquetes
+    Buffer().swap(batch);
+    Buffer().swap(currentBlock);
+    localBuckets.clear();
+
+    // El archivo de la tarea ya se leyó completo: se borra (salvo el de entrada, que es también la salida)
+    if (task.id != 0) {
+        filesystem::remove(fileName);
+        queue.liveTempFiles--;
+    }
 
-    // Volcar cualquier contenido restante en los buffers a los archivos temporales
-    for (int i = 0; i < a; ++i) {
-        flushBufferToFile(partitionFiles[i], partitionBuffers[i]);
+    // Volcar el contenido restante en los buffers a los archivos temporales.
+    // En modo híbrido, las particiones que nunca llenaron un bloque se quedan en memoria (no se abren archivos)
+    bool absorb = context.quicksort_options.absorb_small_partitions;
+    for (int i = 0; i < numPartitions; ++i) {
+        if (!absorb || spilled[i]) {
+            flushBufferToPartition(context, partitionHandles[i], partitionFiles[i], partitionBuffers[i], keepOpen);
+            spilled[i] = spilled[i] || partitionSizes[i] > 0;
+        }
+        if (partitionHandles[i]) fclose(partitionHandles[i]);
     }
 
-    // 4) Recursivamente aplicar quicksort a cada partición
-    for (int i = 0; i < a; ++i) {
-        long partitionSize = filesystem::file_size(partitionFiles[i]) / sizeof(int64_t);
-        if (partitionSize > 0) {
-            externalQuicksort(partitionFiles[i], partitionSize, a, false); // first_run = false porque ya no queremos contar accesos a disco
+    // 4) y 5) Recorrer las particiones en orden llevando la posición de salida de cada una (cursor):
+    // las que no caben en M se agregan a la cola como nuevas tareas y escribirán directo en su posición del archivo final;
+    // en modo híbrido las pequeñas (<= M) se empaquetan con sus hermanas contiguas en una carga de tamaño M,
+    // se ordenan juntas en memoria y se escriben directo (los rangos de las hermanas no se traslapan).
+    // Después de cada partición va su bucket de igualdad, que se escribe una sola vez
+    long cursor = task.outputOffset;
+    Buffer packBuffer;
+    if (memory_governor.currentPolicy() != MemoryGovernor::UNLIMITED) {
+        // Con presupuesto, el paquete usa lo que queda de M (los buffers de las particiones pequeñas siguen vivos y queda
+        // un bloque para los buckets de igualdad); se reserva una vez para que no crezca al doble
+        M_elements = min(M_elements, (long)(memory_governor.available() / sizeof(int64_t)) - (long)(context.B_SIZE / sizeof(int64_t)) - 8);
+        M_elements = max(M_elements, 1L);
+        packBuffer.reserve(M_elements);
+    }
+
+    for (int i = 0; i < numPartitions; ++i) {
+        if (absorb && partitionSizes[i] <= M_elements) {
+            // Si la partición no cabe en el paquete actual, ordenar y escribir el paquete primero
+            if ((long)packBuffer.size() + partitionSizes[i] > M_elements) {
+                sortAndWritePack(context, output, cursor, packBuffer);
+            }
+            if (spilled[i]) {
+                appendFileToBuffer(context, partitionFiles[i], packBuffer, partitionSizes[i]);
+                filesystem::remove(partitionFiles[i]);
+            } else {
+                packBuffer.insert(packBuffer.end(), partitionBuffers[i].begin(), partitionBuffers[i].end());
+                Buffer().swap(partitionBuffers[i]);
+            }
+        } else {
+            // Partición grande: vaciar el paquete pendiente (termina justo en el cursor)
+            sortAndWritePack(context, output, cursor, packBuffer);
+
+            if (partitionSizes[i] > 0) {
+                // Sin progreso: la partición quedó con todos los elementos (todos iguales o a la derecha de los pivotes),
+                // se procesa con buckets de igualdad para garantizar que cada nivel saque al menos los valores de sus pivotes
+                bool noProgress = partitionSizes[i] == N_SIZE;
+                QuicksortTask child = {firstChildId + i, partitionSizes[i], cursor, equality_buckets || noProgress};
+                pushTask(context, queue, child);
+                queue.liveTempFiles++;
+            }
+        }
+        cursor += partitionSizes[i];
+
+        // Bucket de igualdad del pivote i: ya está ordenado, va al paquete si cabe o se escribe directo
+        if (i < numPivots && equalCounts[i] > 0) {
+            if (absorb && (long)packBuffer.size() + equalCounts[i] <= M_elements) {
+                packBuffer.insert(packBuffer.end(), equalCounts[i], pivots[i]);
+            } else {
+                sortAndWritePack(context, output, cursor, packBuffer);
+                writeRepeatedToFile(context, output, cursor, pivots[i], equalCounts[i]);
+            }
+            cursor += equalCounts[i];
         }
     }
 
-    // 5) Unir las particiones de vuelta al archivo original
-    file = fopen(fileName.c_str(), "wb");  // Abrir el archivo para reescribirlo
-    vector<int64_t> mergeBuffer;
-    for (int i = 0; i < a; ++i) {
-        FILE* partitionFile = fopen(partitionFiles[i].c_str(), "rb");
-        while (true) {
-            vector<int64_t> tempBuffer(elemsPerBlock);
-            size_t numElements = fread(tempBuffer.data(), sizeof(int64_t), elemsPerBlock, partitionFile);
-            if (numElements == 0) break;
-            fwrite(tempBuffer.data(), sizeof(int64_t), numElements, file);
-            if (first_run)++ disk_access;  // Contar acceso a disco solo en first_run
+    // Último paquete pendiente
+    sortAndWritePack(context, output, cursor, packBuffer);
+}
+
+
+int presortedDirection(SortContext& context, FILE* file, long N_SIZE) {
+    /* Recorre el archivo por bloques mientras siga en orden ascendente o descendente; se detiene al encontrar una inversión
+    de ambos órdenes (en una entrada aleatoria, dentro del primer bloque)
+    args:
+        context: contexto del ordenamiento
+        file: puntero al archivo
+        N_SIZE: número total de elementos en el archivo
+    returns:
+        1 si está en orden ascendente, -1 si está en orden descendente, 0 si no
+    */
+
+    long elemsPerBlock = context.B_SIZE / sizeof(int64_t);
+    Buffer block(elemsPerBlock);
+    bool ascending = true, descending = true;
+    int64_t previous = 0;
+    fseek(file, 0, SEEK_SET);
+    for (long read = 0; (ascending || descending) && read < N_SIZE; ) {
+        size_t numRead = fread(block.data(), sizeof(int64_t), min(elemsPerBlock, N_SIZE - read), file);
+        if (numRead == 0) break;
+        context.disk_access++;
+        for (size_t i = 0; i < numRead && (ascending || descending); ++i) {
+            if (read + (long)i > 0) {
+                if (block[i] < previous) ascending = false;
+                if (block[i] > previous) descending = false;
+            }
+            previous = block[i];
         }
-        fclose(partitionFile);
+        read += numRead;
+    }
+    return ascending ? 1 : descending ? -1 : 0;
+}
+
+
+void reverseInPlace(SortContext& context, FILE* file, long N_SIZE) {
+    /* Invierte el archivo en el lugar: intercambia bloques de los dos extremos hacia el centro, invirtiendo cada uno
+    args:
+        context: contexto del ordenamiento
+        file: puntero al archivo (abierto en modo lectura/escritura)
+        N_SIZE: número total de elementos en el archivo
+    returns:
+        void
+    */
+
+    long elemsPerBlock = context.B_SIZE / sizeof(int64_t);
+    long lo = 0, hi = N_SIZE;
+    Buffer front(elemsPerBlock), back(elemsPerBlock);
+    while (hi - lo >= 2 * elemsPerBlock) {
+        fseek(file, lo * sizeof(int64_t), SEEK_SET);
+        size_t _ = fread(front.data(), sizeof(int64_t), elemsPerBlock, file);
+        fseek(file, (hi - elemsPerBlock) * sizeof(int64_t), SEEK_SET);
+        _ = fread(back.data(), sizeof(int64_t), elemsPerBlock, file);
+        context.disk_access += 2;
+        reverse(front.begin(), front.end());
+        reverse(back.begin(), back.end());
+        writeBlocksToFile(context, file, lo, back);
+        writeBlocksToFile(context, file, hi - elemsPerBlock, front);
+        lo += elemsPerBlock;
+        hi -= elemsPerBlock;
+    }
+    // Centro: menos de dos bloques
+    if (hi > lo) {
+        Buffer middle(hi - lo);
+        fseek(file, lo * sizeof(int64_t), SEEK_SET);
+        size_t _ = fread(middle.data(), sizeof(int64_t), hi - lo, file);
+        context.disk_access += (hi - lo + elemsPerBlock - 1) / elemsPerBlock;
+        reverse(middle.begin(), middle.end());
+        writeBlocksToFile(context, file, lo, middle);
+    }
+}
+
 
-        // Eliminar archivo temporal
-        filesystem::remove(partitionFiles[i]);  
+void externalQuicksort(SortContext& context, const string& fileName, long N_SIZE, int a, bool equality_buckets) {
+    /* Función principal de Quicksort Externo: en lugar de recursión, una cola de tareas procesa las particiones
+    hasta que todas quedan escritas en su posición del archivo final (que es el mismo archivo de entrada)
+    args:
+        context: contexto del ordenamiento
+        fileName: nombre del archivo con los datos a ordenar
+        N_SIZE: número total de elementos en el archivo
+        a: número de particiones que se crearán
+        equality_buckets: si es true, los elementos iguales a un pivote van a un bucket de igualdad que no se recursa
+    returns:
+        void
+    */
 
-        // Insertar pivote si es necesario
-        if (i < a - 1) {
-            int64_t pivot = block[i];
-            fwrite(&pivot, sizeof(int64_t), 1, file);
+    memory_governor.beginPhase("quicksort");
+    QuicksortQueue queue;
+    queue.spillFile = context.tempName("tasks");
+    filesystem::remove(queue.spillFile);
+
+    // El archivo se lee completo en la primera tarea antes de escribir cualquier resultado, por lo que se puede ordenar en el lugar
+    FILE* output = fopen(fileName.c_str(), "rb+");
+
+    // Entrada ya ordenada (o en orden descendente): no se particiona
+    if (context.quicksort_options.detect_presorted) {
+        int direction = presortedDirection(context, output, N_SIZE);
+        if (direction != 0) {
+            if (direction == -1) reverseInPlace(context, output, N_SIZE);
+            fclose(output);
+            memory_governor.endPhase();
+            return;
         }
     }
-    fclose(file);
+
+    pushTask(context, queue, {0, N_SIZE, 0, equality_buckets});
+
+    QuicksortTask task;
+    while (popTask(context, queue, task)) {
+        quicksortLevel(context, fileName, task, a, output, queue);
+    }
+    fclose(output);
+    memory_governor.endPhase();
 }
 
 // --------------------------------- Funciones auxiliares ---------------------------------
@@ -246,7 +734,7 @@ void printFirstElements(FILE* file, long numElements) {
         void
     */
 
-    vector<int64_t> buffer(numElements);
+    Buffer buffer(numElements);
     fseek(file, 0, SEEK_SET);
     size_t bytesRead = fread(buffer.data(), sizeof(int64_t), numElements, file);
 
@@ -270,9 +758,40 @@ void printFirstElements(FILE* file, long numElements) {
 
 // --------------------------------- Función para runnear en main.cpp ---------------------------------
 
+void set_quicksort_options(const QuicksortOptions& options) {
+    /* Fija las opciones con las que parten los contextos creados después (los existentes conservan las suyas)
+    args:
+        options: estructura con las opciones del algoritmo
+    returns:
+        void
+    */
+
+    quicksort_options = options;
+}
+
+QuicksortOptions default_quicksort_options() {
+    // Opciones fijadas con set_quicksort_options (las de fábrica si no se llamó)
+    return quicksort_options;
+}
+
 #include "sequence_generator.hpp"
 
-extern void externalQuicksort(const std::string& inputFile, long N_SIZE, int a, bool first_run);
+extern void externalQuicksort(SortContext& context, const std::string& inputFile, long N_SIZE, int a, bool equality_buckets);
+
+long long run_quicksort(SortContext& context, const std::string& inputFile, long N_SIZE) {
+    /* Ejecuta el Quicksort Externo con la configuración, el contador y los temporales de un contexto
+    args:
+        context: contexto del ordenamiento (B, M, a y opciones)
+        inputFile: nombre del archivo de entrada, se ordena en el lugar
+        N_SIZE: número total de elementos en el archivo
+    returns:
+        disk_access: número de accesos al disco de esta llamada
+    */
+
+    context.disk_access = 0;  // cada llamada cuenta sus propios accesos
+    externalQuicksort(context, inputFile, N_SIZE, context.a, context.quicksort_options.equality_buckets);
+    return context.disk_access;
+}
 
 long long run_quicksort(const std::string& inputFile, long N_SIZE, int a, long B_SIZE_arg, long M_SIZE_arg) {
     /* Función principal para ejecutar el Quicksort Externo
@@ -280,15 +799,14 @@ long long run_quicksort(const std::string& inputFile, long N_SIZE, int a, long B
         inputFile: nombre del archivo de entrada
         N_SIZE: número total de elementos en el archivo
         a: número de particiones que se crearán
-        B_SIZE_arg: tamaño del bloque en bytes
+        B_SIZE_arg: tamaño del bloque en bytes (0 = el del perfil del dispositivo)
         M_SIZE_arg: tamaño de la memoria principal en bytes
     returns:
         disk_access: número de accesos al disco
     */
 
-    // Variables globales
-    B_SIZE = B_SIZE_arg; // tamaño del bloque (estandar 4096 bytes)
-    M_SIZE = M_SIZE_arg; // tamaño de la memoria principal (50 MB)
+    // Contexto propio de la llamada: bloque (estandar 4096 bytes, 0 = el del perfil del dispositivo) y memoria principal
+    SortContext context(B_SIZE_arg > 0 ? B_SIZE_arg : profile_block_size(M_SIZE_arg, a), M_SIZE_arg, a);
 
     /*
     // Show some elements before sorting
@@ -304,7 +822,7 @@ long long run_quicksort(const std::string& inputFile, long N_SIZE, int a, long B
     */
 
     // Execute the external quicksort
-    externalQuicksort(inputFile, N_SIZE, a, true);
+    long long accesses = run_quicksort(context, inputFile, N_SIZE);
 
     /*
     // Optionally, print the results after sorting (if needed)
@@ -318,5 +836,5 @@ long long run_quicksort(const std::string& inputFile, long N_SIZE, int a, long B
         fclose(file);
     }
     */
-    return disk_access;
+    return accesses;
 }
@@ -0,0 +1,42 @@
+//se define M_SIZE <- tamaño de la memoria principal: valor capturado desde los args
+//se define B_SIZE <- tamaño del bloque en bytes
+//se define N_SIZE <- número de elementos a ordenar (input)
+//se define a <- cantidad máxima de buckets por pasada (se usa la mayor potencia de 2 que no supera a a)
+
+//radix sort externo MSD:
+//si N_SIZE <= M_SIZE
+// se ordena el bloque completo en memoria principal con sort
+//else N_SIZE > M_SIZE
+// 1) Se elige el primer bit en que difieren la llave mínima y la máxima del rango (en la primera pasada se usan los bits más significativos)
+// 2) Se lee el input por bloques de tamaño B_SIZE y cada elemento va al bucket que indican sus siguientes log2(a) bits desde ese punto
+//    (sin muestreo de pivotes ni comparaciones, y con llaves uniformes los buckets quedan del mismo tamaño)
+// 3) Mientras se distribuye se guarda el tamaño, la llave mínima y la máxima de cada bucket
+// 4) Cada bucket se escribe en su posición del archivo de salida (la suma de los tamaños de los buckets anteriores):
+//    si cabe en M se ordena en memoria, si todas sus llaves son iguales se escribe directo, y si no se vuelve a distribuir
+//    a partir del primer bit en que difieren su mínima y su máxima (división adaptativa de buckets)
+
+#include <cstdint>
+#include <string>
+#include "../headers/radixsort.hpp"
+#include "../headers/external_sorter.hpp"
+#include "../headers/planner.hpp"
+
+// El radix sort externo está implementado de forma genérica en ExternalSorter (headers/external_sorter.hpp);
+// aquí se instancia para archivos de enteros de 64 bits
+
+long long run_radixsort(const std::string& inputFile, long N_SIZE, int a, long B_SIZE_arg, long M_SIZE_arg) {
+    /* Función principal para ejecutar el Radix Sort Externo
+    args:
+        inputFile: nombre del archivo de entrada
+        N_SIZE: número total de elementos en el archivo
+        a: número máximo de buckets por pasada
+        B_SIZE_arg: tamaño del bloque en bytes (0 = el del perfil del dispositivo)
+        M_SIZE_arg: tamaño de la memoria principal en bytes
+    returns:
+        número de accesos al disco
+    */
+
+    if (B_SIZE_arg <= 0) B_SIZE_arg = profile_block_size(M_SIZE_arg, a);
+    ExternalSorter<int64_t> sorter(B_SIZE_arg, M_SIZE_arg, a);
+    return sorter.radixsort(inputFile, inputFile + ".radix.sorted", N_SIZE);
+}
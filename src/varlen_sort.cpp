@@ -0,0 +1,489 @@
+//se define M_SIZE <- tamaño de la memoria principal en bytes (datos de los registros + índice del tramo)
+//se define B_SIZE <- tamaño del bloque en bytes (unidad de lectura y escritura)
+//se define a <- aridad de la mezcla
+
+//ordenamiento externo de registros de largo variable (líneas de log):
+// 1) Formación de tramos: se llena un buffer de datos con registros completos del input (leído por bloques B) y se arma
+//    un índice de entradas (prefijo de 8 bytes normalizado, offset, largo). El prefijo son los primeros 8 bytes de la llave
+//    (VarlenKey: un campo y/o un rango de bytes del registro, por defecto el registro completo) en big endian, por lo que
+//    comparar prefijos como enteros equivale a comparar los bytes; solo si dos prefijos empatan se comparan las llaves
+//    completas. Se ordena el índice (16 bytes por entrada: prefijo, y posición y largo empaquetados en 64 bits; sin mover
+//    los registros) y se escribe el tramo.
+// 2) Los tramos se guardan en un formato interno (largo, prefijo, bytes), así la mezcla mueve registros sin volver a buscar
+//    el fin de línea ni recalcular el prefijo.
+// 3) Mezcla a-aria con heap; si hay más de a tramos se mezclan por grupos de a en varias pasadas.
+//    La última pasada escribe en el formato del input.
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <queue>
+#include <filesystem>
+#include "../headers/varlen_sort.hpp"
+#include "../headers/memory_governor.hpp"
+#include "../headers/sort_context.hpp"
+
+using namespace std;
+
+// B, M y el contador de accesos al disco (una lectura o escritura de bloque) viven en el SortContext de cada llamada;
+// todos los buffers (datos e índice de los tramos, bloques de lectura y escritura) salen de la arena del gobernador
+
+// Entrada del índice de un tramo: el registro queda en el buffer de datos, solo se ordena esta entrada (16 bytes)
+struct IndexEntry {
+    uint64_t prefix;     // primeros 8 bytes de la llave en big endian (con ceros si es más corta)
+    uint64_t location;   // posición del registro en el buffer de datos y su largo, empaquetados según IndexLayout
+};
+static_assert(sizeof(IndexEntry) == 16, "el índice ocupa un tercio de M: cada byte de más son entradas de menos por tramo");
+
+// Reparto de los 64 bits de location: la posición usa los bits que necesita el buffer de datos (pasa de 32 con M de varios
+// GB) y el largo los que quedan, hasta 32; un registro más largo que eso no cabría en el buffer de todos modos si este es
+// de menos de 4 GB, y con buffers más grandes se rechaza
+struct IndexLayout {
+    int lengthBits;
+    uint64_t lengthMask;
+
+    explicit IndexLayout(size_t dataCapacity) {
+        int offsetBits = 1;
+        while (offsetBits < 64 && (dataCapacity >> offsetBits) > 0) offsetBits++;
+        lengthBits = min(32, 64 - offsetBits);
+        lengthMask = (uint64_t(1) << lengthBits) - 1;
+    }
+
+    uint64_t maxLength() const { return lengthMask; }
+    uint64_t pack(size_t offset, uint32_t length) const { return (uint64_t)offset << lengthBits | length; }
+    size_t offset(const IndexEntry& entry) const { return entry.location >> lengthBits; }
+    uint32_t length(const IndexEntry& entry) const { return entry.location & lengthMask; }
+};
+
+// Encabezado de cada registro en los tramos temporales
+struct RunRecordHeader {
+    uint32_t length;
+    uint64_t prefix;
+} __attribute__((packed));
+
+// --------------------------------- Funciones auxiliares ---------------------------------
+
+static void keySpan(const char* data, uint32_t length, const VarlenKey& key, const char*& keyData, uint32_t& keyLength) {
+    /* Bytes de la llave dentro de un registro
+    args:
+        data, length: registro
+        key: especificación de la llave
+        keyData, keyLength: donde se dejan el inicio y el largo de la llave
+    returns:
+        void
+    */
+
+    const char* end = data + length;
+    if (key.delimiter != 0) {
+        for (int i = 0; i < key.field && data < end; ++i) {
+            const char* next = static_cast<const char*>(memchr(data, key.delimiter, end - data));
+            data = next ? next + 1 : end;
+        }
+        const char* fieldEnd = static_cast<const char*>(memchr(data, key.delimiter, end - data));
+        if (fieldEnd) end = fieldEnd;
+    }
+    keyData = data + min<size_t>(key.offset, end - data);
+    keyLength = end - keyData;
+    if (key.length > 0) keyLength = min(keyLength, key.length);
+}
+
+
+static uint64_t normalizedPrefix(const char* data, uint32_t length) {
+    /* Prefijo normalizado: los primeros 8 bytes como entero big endian, para comparar sin tocar los datos
+    args:
+        data: puntero a la llave
+        length: largo de la llave
+    returns:
+        prefijo de 64 bits
+    */
+
+    uint64_t prefix = 0;
+    for (uint32_t i = 0; i < 8; ++i) {
+        prefix = (prefix << 8) | (i < length ? static_cast<unsigned char>(data[i]) : 0);
+    }
+    return prefix;
+}
+
+
+static bool recordLess(uint64_t prefixA, const char* dataA, uint32_t lengthA, uint64_t prefixB, const char* dataB, uint32_t lengthB,
+                       const VarlenKey& key) {
+    /* Orden de los registros: primero el prefijo de la llave, y solo si empata se comparan las llaves completas
+    args:
+        prefixA, dataA, lengthA: primer registro
+        prefixB, dataB, lengthB: segundo registro
+        key: especificación de la llave
+    returns:
+        true si el primer registro va antes
+    */
+
+    if (prefixA != prefixB) return prefixA < prefixB;
+    keySpan(dataA, lengthA, key, dataA, lengthA);
+    keySpan(dataB, lengthB, key, dataB, lengthB);
+    int cmp = memcmp(dataA, dataB, min(lengthA, lengthB));
+    if (cmp != 0) return cmp < 0;
+    return lengthA < lengthB;
+}
+
+
+// Escritura bufferizada por bloques de tamaño B
+struct BlockWriter {
+    SortContext& context;
+    FILE* file;
+    ArenaVector<char> buffer;
+    size_t used = 0;
+
+    BlockWriter(SortContext& context, const string& fileName) : context(context), file(fopen(fileName.c_str(), "wb")), buffer(context.B_SIZE) {
+        if (!file) {
+            perror("Error while opening the file");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    void write(const void* data, size_t length) {
+        const char* bytes = static_cast<const char*>(data);
+        while (length > 0) {
+            size_t toCopy = min(length, buffer.size() - used);
+            memcpy(buffer.data() + used, bytes, toCopy);
+            used += toCopy;
+            bytes += toCopy;
+            length -= toCopy;
+            if (used == buffer.size()) flush();
+        }
+    }
+
+    void flush() {
+        if (used == 0) return;
+        fwrite(buffer.data(), 1, used, file);
+        context.disk_access++;
+        used = 0;
+    }
+
+    void close() {
+        flush();
+        fclose(file);
+    }
+};
+
+
+// Lectura de un tramo temporal, registro a registro, con un buffer de un bloque B (crece si un registro no cabe)
+struct RunReader {
+    SortContext* context = nullptr;
+    FILE* file = nullptr;
+    ArenaVector<char> buffer;
+    size_t pos = 0, filled = 0;
+    bool eof = false;
+
+    // Registro actual
+    uint64_t prefix = 0;
+    uint32_t length = 0;
+    const char* data = nullptr;
+
+    bool ensure(size_t n) {
+        // Deja al menos n bytes disponibles desde pos; retorna false si el tramo no los tiene
+        if (filled - pos >= n) return true;
+        memmove(buffer.data(), buffer.data() + pos, filled - pos);
+        filled -= pos;
+        pos = 0;
+        if (buffer.size() < n) buffer.resize(n);
+        while (filled < n && !eof) {
+            size_t toRead = min((size_t)context->B_SIZE, buffer.size() - filled);
+            size_t bytesRead = fread(buffer.data() + filled, 1, toRead, file);
+            if (bytesRead == 0) {
+                eof = true;
+                break;
+            }
+            context->disk_access++;
+            filled += bytesRead;
+        }
+        return filled - pos >= n;
+    }
+
+    bool next() {
+        // Carga el siguiente registro del tramo (el anterior deja de ser válido)
+        if (!ensure(sizeof(RunRecordHeader))) return false;
+        RunRecordHeader header;
+        memcpy(&header, buffer.data() + pos, sizeof(header));
+        if (!ensure(sizeof(header) + header.length)) return false;
+        prefix = header.prefix;
+        length = header.length;
+        data = buffer.data() + pos + sizeof(header);
+        pos += sizeof(header) + header.length;
+        return true;
+    }
+};
+
+
+static void writeRecord(BlockWriter& writer, const char* data, uint32_t length, uint64_t prefix, bool internalFormat, VarlenFormat format) {
+    /* Escribe un registro en el formato interno de los tramos o en el formato del input
+    args:
+        writer: salida bufferizada
+        data, length, prefix: registro a escribir
+        internalFormat: true para tramos temporales (largo + prefijo + bytes)
+        format: formato del input, usado si internalFormat es false
+    returns:
+        void
+    */
+
+    if (internalFormat) {
+        RunRecordHeader header = {length, prefix};
+        writer.write(&header, sizeof(header));
+        writer.write(data, length);
+    } else if (format == VarlenFormat::LENGTH_PREFIXED) {
+        writer.write(&length, sizeof(length));
+        writer.write(data, length);
+    } else {
+        writer.write(data, length);
+        writer.write("\n", 1);
+    }
+}
+
+// --------------------------------- Formación de tramos ---------------------------------
+
+static vector<string> createVarlenRuns(SortContext& context, const string& inputFile, VarlenFormat format, const VarlenKey& key) {
+    /* Crea tramos ordenados de a lo más M bytes (datos + índice) en formato interno
+    args:
+        context: contexto del ordenamiento
+        inputFile: nombre del archivo de entrada
+        format: formato de los registros del input
+        key: especificación de la llave
+    returns:
+        nombres de los archivos de los tramos creados
+    */
+
+    // Dos tercios de M para los datos de los registros y un tercio para el índice, descontando el bloque del escritor del
+    // tramo (con ADAPT, de lo que queda de M)
+    long memory = context.M_SIZE;
+    if (memory_governor.adapts()) memory = (long)min<size_t>(memory, memory_governor.available());
+    memory = max(3 * context.B_SIZE, memory - context.B_SIZE);
+    size_t dataCapacity = max(context.B_SIZE, memory / 3 * 2);
+    // Sin pasar del tamaño del input (con M de varios GB, un archivo chico no reserva toda la memoria), más un byte: así la
+    // lectura llega al fin del archivo y una última línea sin '\n' se cierra en vez de esperar al siguiente tramo
+    error_code error;
+    uintmax_t inputBytes = filesystem::file_size(inputFile, error);
+    if (!error) dataCapacity = min(dataCapacity, max((size_t)context.B_SIZE, (size_t)inputBytes + 1));
+    size_t indexCapacity = max(1L, memory / 3 / (long)sizeof(IndexEntry));
+    indexCapacity = min(indexCapacity, dataCapacity + 1);  // cada registro ocupa al menos un byte del buffer
+
+    IndexLayout layout(dataCapacity);
+    ArenaVector<char> data(dataCapacity);
+    ArenaVector<IndexEntry> index;
+    index.reserve(indexCapacity);
+    vector<string> runs;
+
+    FILE* in = fopen(inputFile.c_str(), "rb");
+    if (!in) {
+        perror("Error while opening the file");
+        exit(EXIT_FAILURE);
+    }
+
+    size_t filled = 0;
+    bool eof = false;
+    while (true) {
+        // Completar el buffer de datos por bloques B
+        while (filled < dataCapacity && !eof) {
+            size_t bytesRead = fread(data.data() + filled, 1, min((size_t)context.B_SIZE, dataCapacity - filled), in);
+            if (bytesRead == 0) {
+                eof = true;
+                break;
+            }
+            context.disk_access++;
+            filled += bytesRead;
+        }
+
+        // Armar el índice con los registros completos del buffer
+        index.clear();
+        size_t pos = 0;
+        while (pos < filled && index.size() < indexCapacity) {
+            size_t start, end;
+            uint32_t length;
+            if (format == VarlenFormat::NEWLINE) {
+                const char* newline = static_cast<const char*>(memchr(data.data() + pos, '\n', filled - pos));
+                if (!newline && !eof) break;  // línea incompleta: pasa al siguiente tramo
+                size_t lineLength = (newline ? newline - data.data() : filled) - pos;
+                if (lineLength > UINT32_MAX) {
+                    cerr << "Error: una línea pasa de 4 GB (el largo de un registro es de 32 bits)" << endl;
+                    exit(EXIT_FAILURE);
+                }
+                start = pos;
+                length = lineLength;
+                end = start + length + (newline ? 1 : 0);
+            } else {
+                if (filled - pos < sizeof(uint32_t)) break;
+                memcpy(&length, data.data() + pos, sizeof(uint32_t));
+                if (filled - pos - sizeof(uint32_t) < length) break;  // incompleto (o más largo que el buffer: error abajo)
+                start = pos + sizeof(uint32_t);
+                end = start + length;
+            }
+            if (length > layout.maxLength()) {
+                cerr << "Error: un registro pasa de " << layout.maxLength() << " bytes (máximo del índice con este buffer de datos)" << endl;
+                exit(EXIT_FAILURE);
+            }
+            const char* keyData;
+            uint32_t keyLength;
+            keySpan(data.data() + start, length, key, keyData, keyLength);
+            index.push_back({normalizedPrefix(keyData, keyLength), layout.pack(start, length)});
+            pos = end;
+        }
+
+        if (index.empty()) {
+            if (filled == 0 || (eof && format == VarlenFormat::LENGTH_PREFIXED)) break;  // fin del input (o registro truncado al final)
+            cerr << "Error: un registro no cabe en la memoria disponible para un tramo" << endl;
+            exit(EXIT_FAILURE);
+        }
+
+        // Ordenar el índice: la comparación completa solo ocurre cuando los prefijos empatan
+        const char* base = data.data();
+        sort(index.begin(), index.end(), [base, &key, &layout](const IndexEntry& x, const IndexEntry& y) {
+            return recordLess(x.prefix, base + layout.offset(x), layout.length(x), y.prefix, base + layout.offset(y), layout.length(y), key);
+        });
+
+        // Escribir el tramo en formato interno
+        runs.push_back(context.tempName("vrun" + to_string(runs.size())));
+        BlockWriter writer(context, runs.back());
+        for (const IndexEntry& entry : index) {
+            writeRecord(writer, base + layout.offset(entry), layout.length(entry), entry.prefix, true, format);
+        }
+        writer.close();
+
+        // Los bytes que no alcanzaron a formar parte del tramo pasan al inicio del buffer
+        memmove(data.data(), data.data() + pos, filled - pos);
+        filled -= pos;
+        if (eof && filled == 0) break;
+    }
+    fclose(in);
+    return runs;
+}
+
+// --------------------------------- Mezcla ---------------------------------
+
+static void mergeVarlenRuns(SortContext& context, const vector<string>& runs, const string& outputFile, bool internalFormat, VarlenFormat format,
+                            const VarlenKey& key) {
+    /* Mezcla tramos en formato interno con un heap; los registros se copian tal cual desde el buffer de cada tramo
+    args:
+        context: contexto del ordenamiento
+        runs: archivos de los tramos a mezclar
+        outputFile: archivo de salida
+        internalFormat: true si la salida es un tramo intermedio
+        format: formato del input (para la salida final)
+        key: especificación de la llave
+    returns:
+        void
+    */
+
+    vector<RunReader> readers(runs.size());
+    for (size_t i = 0; i < runs.size(); ++i) {
+        readers[i].context = &context;
+        readers[i].file = fopen(runs[i].c_str(), "rb");
+        if (!readers[i].file) {
+            perror("Error while opening the file");
+            exit(EXIT_FAILURE);
+        }
+        readers[i].buffer.resize(context.B_SIZE);
+    }
+
+    auto greater = [&readers, &key](int x, int y) {
+        const RunReader& rx = readers[x];
+        const RunReader& ry = readers[y];
+        return recordLess(ry.prefix, ry.data, ry.length, rx.prefix, rx.data, rx.length, key);
+    };
+    priority_queue<int, vector<int>, decltype(greater)> heap(greater);
+    for (size_t i = 0; i < readers.size(); ++i) {
+        if (readers[i].next()) heap.push(i);
+    }
+
+    BlockWriter writer(context, outputFile);
+    while (!heap.empty()) {
+        int i = heap.top();
+        heap.pop();
+        writeRecord(writer, readers[i].data, readers[i].length, readers[i].prefix, internalFormat, format);
+        if (readers[i].next()) heap.push(i);
+    }
+    writer.close();
+
+    for (size_t i = 0; i < runs.size(); ++i) {
+        fclose(readers[i].file);
+        filesystem::remove(runs[i]);
+    }
+}
+
+
+bool parse_varlen_key(const std::string& spec, VarlenKey& key) {
+    /* Lee una llave de la línea de comandos: "campo:<n>[:<separador>]" o "bytes:<offset>:<largo>"
+    args:
+        spec: texto de la llave
+        key: llave leída
+    returns:
+        false si el texto no tiene ninguno de los dos formatos
+    */
+
+    key = VarlenKey();
+    size_t colon = spec.find(':');
+    if (colon == string::npos) return false;
+    string kind = spec.substr(0, colon);
+    string rest = spec.substr(colon + 1);
+    size_t second = rest.find(':');
+    string first = rest.substr(0, second);
+    if (first.empty() || first.find_first_not_of("0123456789") != string::npos) return false;
+    if (kind == "campo") {
+        string delimiter = second == string::npos ? " " : rest.substr(second + 1);
+        if (delimiter == "\\t") delimiter = "\t";
+        if (delimiter.size() != 1 || delimiter[0] == '\n') return false;
+        key.delimiter = delimiter[0];
+        key.field = stoi(first);
+        return true;
+    }
+    if (kind == "bytes" && second != string::npos) {
+        string length = rest.substr(second + 1);
+        if (length.empty() || length.find_first_not_of("0123456789") != string::npos) return false;
+        key.offset = stoul(first);
+        key.length = stoul(length);
+        return true;
+    }
+    return false;
+}
+
+
+long long run_varlen_sort(const std::string& inputFile, const std::string& outputFile, VarlenFormat format,
+                          int a, long B_SIZE_arg, long M_SIZE_arg, const VarlenKey& key) {
+    /* Función principal del ordenamiento externo de registros de largo variable
+    args:
+        inputFile: nombre del archivo de entrada
+        outputFile: nombre del archivo de salida
+        format: formato de los registros (líneas o largo como prefijo)
+        a: aridad de la mezcla
+        B_SIZE_arg: tamaño del bloque en bytes
+        M_SIZE_arg: tamaño de la memoria principal en bytes
+        key: llave de los registros (por defecto el registro completo)
+    returns:
+        disk_access: número de accesos al disco
+    */
+
+    SortContext context(B_SIZE_arg, M_SIZE_arg, max(2, a));
+    a = context.a;
+    // Cada mezcla usa un bloque por tramo más el de salida: con ADAPT se mezclan menos tramos por pasada si no caben
+    if (memory_governor.adapts()) a = (int)max(2L, min<long>(a, (long)(memory_governor.available() / context.B_SIZE) - 1));
+
+    vector<string> runs = createVarlenRuns(context, inputFile, format, key);
+
+    // Pasadas intermedias: mientras haya más de a tramos, mezclar grupos de a
+    int pass = 0;
+    while ((int)runs.size() > a) {
+        vector<string> nextRuns;
+        for (size_t first = 0; first < runs.size(); first += a) {
+            vector<string> group(runs.begin() + first, runs.begin() + min(runs.size(), first + a));
+            nextRuns.push_back(context.tempName("vpass" + to_string(pass) + "_" + to_string(nextRuns.size())));
+            mergeVarlenRuns(context, group, nextRuns.back(), true, format, key);
+        }
+        runs = nextRuns;
+        pass++;
+    }
+
+    // Mezcla final en el formato del input
+    mergeVarlenRuns(context, runs, outputFile, false, format, key);
+    return context.disk_access;
+}